@@ -161,6 +161,11 @@ namespace noname_core {
 			{
 				return channel::ichannel::buffer;
 			}
+
+			Channel_stats get_stats() const
+			{
+				return get_buffer()->get_stats();
+			}
 			
 			friend ichannel<T, buffer_size>& operator<< (channel<T, buffer_size>& ch, T& obj)
 			{
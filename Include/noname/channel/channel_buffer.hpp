@@ -5,14 +5,34 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <vector>
+#include <algorithm>
 
 #include "circular_buffer.hpp"
+#include "../perf/tracer.hpp"
 
 #include <concurrent_queue.h>
 
 namespace noname_core {
 	namespace channel {
 
+		// Only counted when built with NONAME_CHANNEL_STATS; otherwise get_stats() returns zeros and enabled == false.
+		struct Channel_stats {
+			bool enabled = false;
+			std::size_t capacity = 0;
+			uint64_t pushes = 0;
+			uint64_t pops = 0;
+			uint64_t producer_blocks = 0;		// insert() found the buffer full and waited
+			uint64_t consumer_blocks = 0;		// get_next() found the buffer empty and waited
+			std::size_t high_water_mark = 0;
+			std::vector<uint64_t> occupancy_histogram;	// sampled on push, bin i covers an equal share of [0, capacity]
+		};
+
+		namespace {
+			constexpr uint64_t CHANNEL_OCCUPANCY_SAMPLE_INTERVAL = 16;
+			constexpr std::size_t CHANNEL_OCCUPANCY_MAX_BINS = 16;
+		}
+
 		template<typename T, std::size_t buffer_size = 0>
 		class channel_buffer
 		{
@@ -23,6 +43,24 @@ namespace noname_core {
 			std::condition_variable output_wait;
 			std::atomic_bool is_closed;
 
+#ifdef NONAME_CHANNEL_STATS
+			// updated with buffer_lock held
+			Channel_stats stats;
+
+			void record_push()
+			{
+				if (stats.occupancy_histogram.empty()) {
+					stats.capacity = buffer_size;
+					stats.occupancy_histogram.resize(std::min(buffer_size + 1, CHANNEL_OCCUPANCY_MAX_BINS));
+				}
+
+				const std::size_t size = buffer.size();
+				stats.high_water_mark = std::max(stats.high_water_mark, size);
+				if (stats.pushes++ % CHANNEL_OCCUPANCY_SAMPLE_INTERVAL == 0)
+					stats.occupancy_histogram[size * stats.occupancy_histogram.size() / (buffer_size + 1)]++;
+			}
+#endif
+
 		public:
 			channel_buffer() : is_closed(false) { }
 			~channel_buffer() = default;
@@ -43,8 +81,13 @@ namespace noname_core {
 				if (buffer.empty())
 				{
 					if (is_closed) return{}; //if closed we always return the default initialisation of T
-						
+
+#ifdef NONAME_CHANNEL_STATS
+					stats.consumer_blocks++;
+#endif
+					const uint64_t blocked_at = perf::tracer::instance().is_enabled() ? perf::tracer::clock_nsec() : 0;
 					input_wait.wait(ulock, [&]() {return !buffer.empty() || is_closed; });
+					if (blocked_at) perf::tracer::instance().complete("channel empty", blocked_at, perf::tracer::clock_nsec());
 					if (buffer.empty() && is_closed) // when we close the channel and there was more waiting then available value 
 						return{};
 				}
@@ -52,6 +95,9 @@ namespace noname_core {
 				T temp;
 				std::swap(temp, buffer.front());
 				buffer.pop();
+#ifdef NONAME_CHANNEL_STATS
+				stats.pops++;
+#endif
 				output_wait.notify_one();
 
 				return temp;
@@ -69,6 +115,9 @@ namespace noname_core {
 				}
 				std::unique_ptr<T> temp = std::make_unique<T>(buffer.front());
 				buffer.pop();
+#ifdef NONAME_CHANNEL_STATS
+				stats.pops++;
+#endif
 				output_wait.notify_one();
 				return std::move(temp);
 			}
@@ -81,13 +130,21 @@ namespace noname_core {
 						std::unique_lock<std::mutex> lock(buffer_lock);
 						if (buffer.full())
 						{
+#ifdef NONAME_CHANNEL_STATS
+							stats.producer_blocks++;
+#endif
+							const uint64_t blocked_at = perf::tracer::instance().is_enabled() ? perf::tracer::clock_nsec() : 0;
 							output_wait.wait(lock, [&]() {return !buffer.full() || is_closed; });
+							if (blocked_at) perf::tracer::instance().complete("channel full", blocked_at, perf::tracer::clock_nsec());
 							if (is_closed) // if channel was closed end all awaiting inputs (cannot send to a closed channel)
 							{
 								return;
 							}
 						}
 						buffer.push(in);
+#ifdef NONAME_CHANNEL_STATS
+						record_push();
+#endif
 					}
 					input_wait.notify_one();
 				}
@@ -95,8 +152,12 @@ namespace noname_core {
 
 			void close()
 			{
-				is_closed = true;
-				input_wait.notify_one();
+				{
+					// taken so a reader between its predicate check and wait() cannot miss the wakeup
+					std::unique_lock<std::mutex> lock(buffer_lock);
+					is_closed = true;
+				}
+				input_wait.notify_all();
 				output_wait.notify_all();
 			}
 
@@ -105,6 +166,19 @@ namespace noname_core {
 				return is_closed;
 			}
 
+			Channel_stats get_stats()
+			{
+#ifdef NONAME_CHANNEL_STATS
+				std::unique_lock<std::mutex> lock(buffer_lock);
+				Channel_stats result = stats;
+				result.enabled = true;
+				result.capacity = buffer_size;
+				return result;
+#else
+				return Channel_stats{};
+#endif
+			}
+
 		};
 	}
 }
@@ -13,6 +13,28 @@
 #include <atomic>
 #include <thread>
 #include <iterator>
+#include <exception>
+#include <cstring>
+
+#if defined(__SANITIZE_THREAD__)
+#define NONAME_MAP_TSAN
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define NONAME_MAP_TSAN
+#endif
+#endif
+
+// ThreadSanitizer builds read control bytes one atomic at a time, see Group::match
+#if (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) && !defined(NONAME_MAP_TSAN)
+#include <emmintrin.h>
+#define NONAME_MAP_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "hash.hpp"
 
 namespace noname_core {
 	namespace concurrent {
@@ -22,8 +44,17 @@ namespace noname_core {
 			constexpr float FIRST_SUBMAP_CAPACITY_MULTIPLIER = 1.0f;
 
 			constexpr std::size_t DEFAULT_MAX_NUM_SUBMAPS = 65536;
-			constexpr std::size_t NEW_SUBMAPS_CAPACITY_MULTIPLIER = 2;
+			constexpr float DEFAULT_GROWTH_FACTOR = 2.0f;
 			constexpr std::size_t FIRST_SUBMAP_MIN_CAPACITY = 11;
+			constexpr float COMPACTED_SUBMAP_CAPACITY_MULTIPLIER = 1.5f;
+
+			constexpr std::size_t PARALLEL_TRAVERSAL_MIN_ENTRIES = 1 << 16;
+
+			constexpr std::size_t PROBE_HISTOGRAM_SIZE = 16;
+
+			// upsert_batch prefetches this many keys ahead, in the newest few submaps only
+			constexpr std::size_t UPSERT_BATCH_WINDOW = 16;
+			constexpr std::size_t UPSERT_BATCH_PREFETCH_SUBMAPS = 4;
 
 			template<typename T>
 			bool is_prime(const T& n, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr)
@@ -53,48 +84,172 @@ namespace noname_core {
 				}
 				return n;
 			}
+
+			inline std::size_t next_power_of_two(std::size_t n) noexcept
+			{
+				std::size_t power = 1;
+				while (power < n) {
+					power <<= 1;
+				}
+				return power;
+			}
+
+			// murmur3 finalizer; std::hash of an integer is the identity on some standard libraries
+			inline uint64_t mix_hash(uint64_t h) noexcept
+			{
+				h ^= h >> 33;
+				h *= 0xff51afd7ed558ccdull;
+				h ^= h >> 33;
+				h *= 0xc4ceb9fe1a85ec53ull;
+				h ^= h >> 33;
+				return h;
+			}
+
+			// maps a well mixed hash to [0, n) with a multiply instead of a division (Lemire's fast range)
+			inline std::size_t fast_range(uint64_t hash, std::size_t n) noexcept
+			{
+#if defined(__SIZEOF_INT128__)
+				return static_cast<std::size_t>((static_cast<unsigned __int128>(hash) * n) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+				return static_cast<std::size_t>(__umulh(hash, n));
+#else
+				return static_cast<std::size_t>(hash % n);
+#endif
+			}
+
+			inline void prefetch(const void* address) noexcept
+			{
+#if defined(NONAME_MAP_SSE2)
+				_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+				__builtin_prefetch(address);
+#endif
+			}
+
+			inline unsigned lowest_bit_index(uint32_t mask) noexcept
+			{
+#ifdef _MSC_VER
+				unsigned long index;
+				_BitScanForward(&index, mask);
+				return index;
+#else
+				return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+			}
+
+			inline unsigned highest_bit_index(uint32_t mask) noexcept
+			{
+#ifdef _MSC_VER
+				unsigned long index;
+				_BitScanReverse(&index, mask);
+				return index;
+#else
+				return 31 - static_cast<unsigned>(__builtin_clz(mask));
+#endif
+			}
 		}
 
+		// Fields marked "scan" are only filled by get_stats(true), which visits every entry.
 		struct Submap_stats {
 			std::size_t capacity;
 			std::size_t num_valid_buckets;
+			std::size_t num_deleted_buckets;
 			float load_factor;
+			float tombstone_ratio;		// deleted among the claimed slots
+			std::size_t bucket_bytes;	// control bytes, group versions and the entry array
+			std::size_t heap_bytes;		// scan: owned by live keys and values, see Heap_usage
+			std::vector<std::size_t> probe_length_histogram;	// scan: [n] counts live entries n + 1 groups into their probe sequence, the last bin is open ended
 		};
 
 		struct Stats {
 			std::size_t num_submaps;
 			std::size_t num_entries;
+			std::size_t directory_bytes;
+			std::size_t total_bytes;	// the map object, directory, submaps and (scan) heap_bytes
 			std::vector<Submap_stats> submaps_stats;
 		};
 
+		// Heap bytes owned by a key or value, beyond sizeof(T). Specialize it for types that own memory.
+		template<typename T, typename Enable = void>
+		struct Heap_usage {
+			static std::size_t get_bytes(const T&) noexcept {
+				return 0;
+			}
+		};
+
+		template<typename Char, typename Traits, typename Allocator>
+		struct Heap_usage<std::basic_string<Char, Traits, Allocator>> {
+			static std::size_t get_bytes(const std::basic_string<Char, Traits, Allocator>& s) noexcept {
+				// short strings live inside the object itself
+				const uintptr_t data = reinterpret_cast<uintptr_t>(s.data());
+				const uintptr_t object = reinterpret_cast<uintptr_t>(&s);
+				if (data >= object && data < object + sizeof(s)) {
+					return 0;
+				}
+				return (s.capacity() + 1) * sizeof(Char);
+			}
+		};
+
+		template<typename T, typename Allocator>
+		struct Heap_usage<std::vector<T, Allocator>> {
+			static std::size_t get_bytes(const std::vector<T, Allocator>& v) noexcept {
+				std::size_t bytes = v.capacity() * sizeof(T);
+				for (const T& element : v) {
+					bytes += Heap_usage<T>::get_bytes(element);
+				}
+				return bytes;
+			}
+		};
+
+		template<typename T1, typename T2>
+		struct Heap_usage<std::pair<T1, T2>> {
+			static std::size_t get_bytes(const std::pair<T1, T2>& p) noexcept {
+				return Heap_usage<T1>::get_bytes(p.first) + Heap_usage<T2>::get_bytes(p.second);
+			}
+		};
+
+		// How a map grows once its newest submap is full. Power-of-two group counts round every capacity up
+		// to a power of two, which would turn any growth factor below 2 into 2, so such factors fall back
+		// to prime counts; a factor above 2 still grows by the next power of two at or above it.
+		struct Growth_policy {
+			float growth_factor = DEFAULT_GROWTH_FACTOR;	// capacity of a new submap relative to the newest one, > 1
+			bool power_of_two = true;						// power-of-two group counts when growth_factor >= 2; false keeps prime counts
+			std::size_t max_num_submaps = DEFAULT_MAX_NUM_SUBMAPS;
+		};
+
+		namespace {
+			constexpr uint64_t SECOND_HASH_SEED = 0x9E3779B97F4A7C15ull;
+		}
+
 		template<typename Key, typename Enable = void>
 		class SecondHash;
 
 		template<typename Key>
 		class SecondHash<Key, typename std::enable_if<std::is_integral<Key>::value>::type> {
-		private:
-			std::hash<Key> hash;
 		public:
-			std::size_t operator()(const Key& key) const {
-				return hash(~key);
+			using is_avalanching = void;
+
+			std::size_t operator()(const Key& key) const noexcept {
+				return static_cast<std::size_t>(hash_int(static_cast<uint64_t>(key), SECOND_HASH_SEED));
 			}
 		};
 
 		template <>
 		class SecondHash<std::string> {
-		private:
-			std::hash<std::string> hash;
 		public:
-			std::size_t operator()(const std::string& key) const {
-				std::string tmp(key);
-				std::reverse(tmp.begin(), tmp.end());
-				return hash(tmp);
+			using is_avalanching = void;
+
+			std::size_t operator()(const std::string& key) const noexcept {
+				return static_cast<std::size_t>(hash_bytes(key.data(), key.size(), SECOND_HASH_SEED));
 			}
 		};
 
+		// KeyHash2 that derives the probe stride from the first hash instead of hashing the key again.
+		struct DerivedHash { };
+
 		template<typename Key, typename Value,
-			typename KeyHash1 = std::hash<Key>,
-			typename KeyHash2 = SecondHash<Key>,
+			typename KeyHash1 = Hash<Key>,
+			typename KeyHash2 = DerivedHash,
 			typename key_equal = std::equal_to<Key>>
 		class concurrent_unordered_map {
 		
@@ -109,44 +264,170 @@ namespace noname_core {
 			typedef Key key_type;
 			typedef Value mapped_type;
 			typedef std::pair<Key, Value> entry;
+			typedef std::pair<std::size_t, std::size_t> hash_pair;
 
 		private:
 			KeyHash1 keyHash1;
 			KeyHash2 keyHash2;
 
-			struct Bucket {
+			// Both hashes handed to the submaps are fully mixed: the start group and the stride come from
+			// their high bits and the tag from the low bits of the first one.
+			template<typename KeyHash>
+			static std::size_t finish_hash(std::size_t hash) noexcept {
+				if constexpr (is_avalanching<KeyHash>::value) {
+					return hash;
+				}
+				else {
+					return static_cast<std::size_t>(mix_hash(hash));
+				}
+			}
 
-				enum class State { EMPTY, BUSY, VALID };
+			std::pair<std::size_t, std::size_t> hash_key(const Key& key) const {
+				const std::size_t hash1 = finish_hash<KeyHash1>(keyHash1(key));
 
-				std::atomic<State> state;
-				entry entry;
+				if constexpr (std::is_same<KeyHash2, DerivedHash>::value) {
+					// the stride reads the high bits, which here are low bits of hash1 the tag does not use
+					constexpr unsigned HALF_BITS = sizeof(std::size_t) * 4;
+					return std::make_pair(hash1, (hash1 << HALF_BITS) | (hash1 >> HALF_BITS));
+				}
+				else {
+					return std::make_pair(hash1, finish_hash<KeyHash2>(keyHash2(key)));
+				}
+			}
 
-				Bucket() : state(State::EMPTY) { }
+			// Control byte of a slot: the top bit set means EMPTY, BUSY or DELETED, otherwise the slot
+			// is full and the low 7 bits are a tag taken from the key's hash. DELETED is a tombstone:
+			// probes walk past it and it is only reclaimed by compact() or clear().
+			enum : uint8_t {
+				CTRL_EMPTY = 0x80,
+				CTRL_BUSY = 0x81,
+				CTRL_DELETED = 0x82
 			};
 
+			static constexpr std::size_t GROUP_SIZE = 16;
+
+			static bool is_full(uint8_t ctrl) noexcept { return (ctrl & 0x80) == 0; }
+
+			// the tag comes from the low bits of the mixed hash, the start group from the high bits
+			static uint8_t make_tag(uint64_t mixed) noexcept {
+				return static_cast<uint8_t>(mixed & 0x7F);
+			}
+
+			// scans of control bytes rely on a fence before reading entries, which ThreadSanitizer ignores
+#ifdef NONAME_MAP_TSAN
+			static constexpr std::memory_order CTRL_SCAN_ORDER = std::memory_order_acquire;
+#else
+			static constexpr std::memory_order CTRL_SCAN_ORDER = std::memory_order_relaxed;
+#endif
+
+			// 16 control bytes; 4 groups share a cache line, so a probe usually reads one line of
+			// metadata and touches an entry only when the tag matches.
+			struct Group {
+				alignas(GROUP_SIZE) std::atomic<uint8_t> ctrl[GROUP_SIZE];
+
+				Group() {
+					for (auto& c : ctrl) c.store(CTRL_EMPTY, std::memory_order_relaxed);
+				}
+
+				// Bit i is set when ctrl[i] == value. The SSE2 path reads the 16 bytes with one plain load
+				// while other threads CAS single bytes. That is a data race to the C++ memory model, but an
+				// aligned 16-byte load never tears a byte on x86, and callers only act on a match after an
+				// acquire (the fence in find, the acquire load in insert, the group seqlock in read_group).
+				// ThreadSanitizer cannot see that (nor the fences), so its builds take the per-byte path with
+				// acquire loads.
+				uint32_t match(uint8_t value) const noexcept {
+#ifdef NONAME_MAP_SSE2
+					const __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+					return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(value)))));
+#else
+					uint32_t mask = 0;
+					for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+						if (ctrl[i].load(CTRL_SCAN_ORDER) == value) mask |= 1u << i;
+					}
+					return mask;
+#endif
+				}
+
+				// bit i is set when ctrl[i] is EMPTY, BUSY or DELETED (any non-full control byte)
+				uint32_t match_not_full() const noexcept {
+#ifdef NONAME_MAP_SSE2
+					return static_cast<uint32_t>(_mm_movemask_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl))));
+#else
+					uint32_t mask = 0;
+					for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+						if (!is_full(ctrl[i].load(CTRL_SCAN_ORDER))) mask |= 1u << i;
+					}
+					return mask;
+#endif
+				}
+			};
+
+			static_assert(sizeof(std::atomic<uint8_t>) == 1, "control bytes must pack into 16-byte groups");
+
 			struct Submap {
 
-				key_equal key_equal;
-				std::vector<Bucket> buckets;
+				key_equal equal;
+				std::vector<Group> groups;
+				std::unique_ptr<entry[]> entries;		// out of line, indexed like the control bytes
+				std::unique_ptr<std::atomic<uint32_t>[]> versions;	// per-group seqlock, odd while a value is being updated
 				float maxload_factor;
 
-				std::atomic<std::size_t> num_valid_buckets;
+				std::atomic<std::size_t> num_valid_buckets;	// slots ever claimed, tombstones included
+				std::atomic<std::size_t> num_deleted_buckets;
+
+				// Inserters register in writers before touching the submap. expand() seals it and waits for
+				// writers to drain before publishing the next one, so once a newer submap is visible every
+				// insert into this one is complete and a key missing here is missing for good.
+				std::atomic<std::size_t> writers;
+				std::atomic<bool> sealed;
 
-				Submap(std::size_t capacity, float maxload_factor)
-					: buckets(capacity)
+				bool powerOfTwo;
+
+				// Double hashing over groups visits all of them when the stride is coprime with the group
+				// count: any stride for a prime count, an odd one for a power of two.
+				static std::size_t get_num_groups_for(std::size_t capacity, bool powerOfTwo) {
+					const std::size_t numGroups = std::max<std::size_t>(2, (capacity + GROUP_SIZE - 1) / GROUP_SIZE);
+					return powerOfTwo ? next_power_of_two(numGroups) : next_prime(numGroups);
+				}
+
+				Submap(std::size_t capacity, float maxload_factor, bool powerOfTwo)
+					: groups(get_num_groups_for(capacity, powerOfTwo))
+					, entries(new entry[groups.size() * GROUP_SIZE])
+					, versions(new std::atomic<uint32_t>[groups.size()])
 					, maxload_factor(maxload_factor)
-					, num_valid_buckets(0) { }
+					, num_valid_buckets(0)
+					, num_deleted_buckets(0)
+					, writers(0)
+					, sealed(false)
+					, powerOfTwo(powerOfTwo) {
+
+					for (std::size_t groupIndex = 0; groupIndex < groups.size(); groupIndex++) {
+						versions[groupIndex].store(0, std::memory_order_relaxed);
+					}
+				}
 
 				std::size_t get_capacity() const noexcept {
-					return buckets.size();
+					return groups.size() * GROUP_SIZE;
+				}
+
+				std::size_t get_num_groups() const noexcept {
+					return groups.size();
+				}
+
+				std::atomic<uint8_t>& get_ctrl(std::size_t index) {
+					return groups[index / GROUP_SIZE].ctrl[index % GROUP_SIZE];
+				}
+
+				const std::atomic<uint8_t>& get_ctrl(std::size_t index) const {
+					return groups[index / GROUP_SIZE].ctrl[index % GROUP_SIZE];
 				}
 
-				Bucket& get_bucket(std::size_t index) {
-					return buckets[index];
+				entry& get_entry(std::size_t index) {
+					return entries[index];
 				}
 
-				const Bucket& get_bucket(std::size_t index) const {
-					return buckets[index];
+				const entry& get_entry(std::size_t index) const {
+					return entries[index];
 				}
 
 				std::size_t get_num_valid_buckets() const noexcept {
@@ -157,44 +438,97 @@ namespace noname_core {
 					num_valid_buckets.fetch_add(1, std::memory_order_relaxed);
 				}
 
+				std::size_t get_num_deleted_buckets() const noexcept {
+					return num_deleted_buckets.load(std::memory_order_relaxed);
+				}
+
+				std::size_t get_start_group(uint64_t mixed) const noexcept {
+					return fast_range(mixed, get_num_groups());
+				}
+
 				std::size_t calculate_probe_increment(std::size_t hash2) const noexcept {
-					const std::size_t modulus = get_capacity() - 1;
-					return 1 + hash2 % modulus;
+					if (powerOfTwo) {
+						return fast_range(hash2, get_num_groups()) | 1;
+					}
+					return 1 + fast_range(hash2, get_num_groups() - 1);
 				}
 
+				// the increment is below the group count, so one subtraction wraps the index
+				std::size_t next_group(std::size_t groupIndex, std::size_t probeIncrement) const noexcept {
+					groupIndex += probeIncrement;
+					return groupIndex >= get_num_groups() ? groupIndex - get_num_groups() : groupIndex;
+				}
+
+				// groups a find for an entry stored in groupIndex reads, counting that one
+				std::size_t get_probe_length(std::size_t hash1, std::size_t hash2, std::size_t groupIndex) const noexcept {
+					const std::size_t probeIncrement = calculate_probe_increment(hash2);
+					std::size_t current = get_start_group(hash1);
+					std::size_t length = 1;
+
+					while (current != groupIndex) {
+						current = next_group(current, probeIncrement);
+						length++;
+					}
+					return length;
+				}
+
+				void prefetch_group(std::size_t hash1) const noexcept {
+					prefetch(&groups[get_start_group(hash1)]);
+				}
+
+				// meant to run once prefetch_group has brought the control bytes in
+				void prefetch_entry(std::size_t hash1) const noexcept {
+					const std::size_t groupIndex = get_start_group(hash1);
+					const uint32_t candidates = groups[groupIndex].match(make_tag(hash1));
+					if (candidates) {
+						prefetch(&entries[groupIndex * GROUP_SIZE + lowest_bit_index(candidates)]);
+					}
+				}
+
+				// A slot is only claimed when every slot before it in probe order is taken, so the
+				// first EMPTY slot ends the search.
 				std::pair<std::size_t, bool> find(const Key& key, std::size_t hash1, std::size_t hash2) const 
 				{
-					const std::size_t startIndex = hash1 % get_capacity();
+					const uint8_t tag = make_tag(hash1);
+					const std::size_t startGroup = get_start_group(hash1);
 					const std::size_t probeIncrement = calculate_probe_increment(hash2);
-					std::size_t index = startIndex;
+					std::size_t groupIndex = startGroup;
 
 					do {
-						const Bucket& bucket = get_bucket(index);
-						typename Bucket::State bucket_state = bucket.state.load(std::memory_order_relaxed);
+						const Group& group = groups[groupIndex];
+						uint32_t candidates = group.match(tag);
 
-						if (bucket_state == Bucket::State::VALID) {
+						if (candidates) {
 							std::atomic_thread_fence(std::memory_order_acquire);
-
-							if (key_equal(bucket.entry.first, key)) {
+						}
+						while (candidates) {
+							const std::size_t index = groupIndex * GROUP_SIZE + lowest_bit_index(candidates);
+							if (equal(get_entry(index).first, key)) {
 								return std::make_pair(index, true);
 							}
+							candidates &= candidates - 1;
 						}
-						else if (bucket_state == Bucket::State::EMPTY) {
+
+						// slots fill in probe order, so nothing lies past an empty slot
+						if (group.match(CTRL_EMPTY)) {
 							return std::make_pair(0, false);
 						}
-						index = (index + probeIncrement) % get_capacity();
+						groupIndex = next_group(groupIndex, probeIncrement);
 
-					} while (index != startIndex);
+					} while (groupIndex != startGroup);
 
 					return std::make_pair(0, false);
 				}
 
 				bool seek(std::size_t& index) const
 				{
-					while (index < get_capacity()) {
-						const Bucket& bucket = get_bucket(index);
+					return seek(index, get_capacity());
+				}
 
-						if (bucket.state.load(std::memory_order_relaxed) == Bucket::State::VALID) {
+				bool seek(std::size_t& index, std::size_t endIndex) const
+				{
+					while (index < endIndex) {
+						if (is_full(get_ctrl(index).load(CTRL_SCAN_ORDER))) {
 							std::atomic_thread_fence(std::memory_order_acquire); // memory fence
 							return true;
 						}
@@ -203,53 +537,160 @@ namespace noname_core {
 					return false;
 				}
 
+				// The version doubles as the writers' lock, so updates within a group are serialized.
+				void lock_group(std::size_t groupIndex) {
+					std::atomic<uint32_t>& version = versions[groupIndex];
+					uint32_t current = version.load(std::memory_order_relaxed);
+
+					while ((current & 1) || !version.compare_exchange_weak(current, current + 1, std::memory_order_acquire)) {
+						if (current & 1) {
+							std::this_thread::yield();
+							current = version.load(std::memory_order_relaxed);
+						}
+					}
+					std::atomic_thread_fence(std::memory_order_release);
+				}
+
+				void unlock_group(std::size_t groupIndex) {
+					versions[groupIndex].fetch_add(1, std::memory_order_release);
+				}
+
+				// Copies the values of the full slots in a group as of one moment between updates, retrying
+				// while a writer holds the group. Keys never change once published, so only values are copied.
+				// Returns the mask of the copied slots.
+				uint32_t read_group(std::size_t groupIndex, Value* values) const {
+					static_assert(std::is_trivially_copyable<Value>::value, "snapshots copy values while they may be updated");
+
+#ifdef NONAME_MAP_TSAN
+					// ThreadSanitizer would report the seqlock read below, so its builds lock the group instead
+					Submap& self = const_cast<Submap&>(*this);
+					self.lock_group(groupIndex);
+					const uint32_t fullMask = copy_group(groupIndex, values);
+					self.unlock_group(groupIndex);
+					return fullMask;
+#else
+					while (1) {
+						const uint32_t before = versions[groupIndex].load(std::memory_order_acquire);
+						if (before & 1) {
+							std::this_thread::yield();
+							continue;
+						}
+
+						// The copy races with update_entry on purpose: it is the seqlock read, and a copy
+						// that overlapped a write is thrown away when the version has moved.
+						const uint32_t fullMask = copy_group(groupIndex, values);
+
+						std::atomic_thread_fence(std::memory_order_acquire);
+						if (versions[groupIndex].load(std::memory_order_relaxed) == before) {
+							return fullMask;
+						}
+					}
+#endif
+				}
+
+				uint32_t copy_group(std::size_t groupIndex, Value* values) const {
+					const uint32_t fullMask = ~groups[groupIndex].match_not_full() & ((1u << GROUP_SIZE) - 1);
+					std::atomic_thread_fence(std::memory_order_acquire);
+
+					for (uint32_t mask = fullMask; mask; mask &= mask - 1) {
+						const unsigned slot = lowest_bit_index(mask);
+						std::memcpy(static_cast<void*>(&values[slot]), &get_entry(groupIndex * GROUP_SIZE + slot).second, sizeof(Value));
+					}
+					return fullMask;
+				}
+
 				struct FullSubmapException { };
 
+				// ivalue is either the value itself or a callable producing it from the key
+				template<typename ValueType>
+				static Value compute_value(const Key& key, ValueType& ivalue) {
+					if constexpr (std::is_invocable<ValueType&, const Key&>::value) {
+						return ivalue(key);
+					}
+					else {
+						return Value(ivalue);
+					}
+				}
+
 				template<typename KeyType, typename ValueType>
 				std::pair<std::size_t, bool> insert(KeyType&& key, std::size_t hash1, std::size_t hash2, ValueType ivalue) {
 
 					Value value = Value();
 					bool valueComputed = false;
 
-					const std::size_t startIndex = hash1 % get_capacity();
+					const uint8_t tag = make_tag(hash1);
+					const std::size_t startGroup = get_start_group(hash1);
 					const std::size_t probeIncrement = calculate_probe_increment(hash2);
-					std::size_t index = startIndex;
+					std::size_t groupIndex = startGroup;
 
 					do {
-						Bucket& bucket = get_bucket(index);
-						typename Bucket::State bucket_state = bucket.state.load(std::memory_order_relaxed);
-
-						if (bucket_state == Bucket::State::EMPTY) {
-							if (!valueComputed) {
-								value = ivalue;
-								valueComputed = true;
-							}
-
-							if (bucket.state.compare_exchange_strong(bucket_state, Bucket::State::BUSY, std::memory_order_relaxed)) {
-
-								bucket.entry.first = std::move(key);
-								bucket.entry.second = std::move(value);
-								bucket.state.store(Bucket::State::VALID, std::memory_order_release);
-
-								increment_num_valid_buckets();
-
-								return std::make_pair(index, true);
-							}
+						// a group of full slots with other tags can neither hold the key nor take it
+						if (!(groups[groupIndex].match(tag) | groups[groupIndex].match_not_full())) {
+							groupIndex = next_group(groupIndex, probeIncrement);
+							continue;
 						}
 
-						if (bucket_state == Bucket::State::VALID || bucket.state.load(std::memory_order_relaxed) == Bucket::State::VALID) {
-							std::atomic_thread_fence(std::memory_order_acquire);
+						for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+							const std::size_t index = groupIndex * GROUP_SIZE + i;
+							std::atomic<uint8_t>& ctrl = get_ctrl(index);
+							uint8_t state = ctrl.load(std::memory_order_acquire);
+
+							while (1) {
+								if (state == CTRL_EMPTY) {
+									if (!valueComputed) {
+										value = compute_value(key, ivalue);
+										valueComputed = true;
+									}
+
+									if (ctrl.compare_exchange_strong(state, CTRL_BUSY, std::memory_order_acquire)) {
+										entry& e = get_entry(index);
+										e.first = std::forward<KeyType>(key);
+										e.second = std::move(value);
+										ctrl.store(tag, std::memory_order_release);
+
+										increment_num_valid_buckets();
+
+										return std::make_pair(index, true);
+									}
+									continue;	// state now holds what beat us to the slot
+								}
+
+								// another writer claimed the slot and may be storing this very key
+								if (state == CTRL_BUSY) {
+									std::this_thread::yield();
+									state = ctrl.load(std::memory_order_acquire);
+									continue;
+								}
+								break;
+							}
 
-							if (key_equal(bucket.entry.first, key)) {
+							if (state == tag && equal(get_entry(index).first, key)) {
 								return std::make_pair(index, false);
 							}
 						}
-						index = (index + probeIncrement) % get_capacity();
-					} while (index != startIndex);
+						groupIndex = next_group(groupIndex, probeIncrement);
+					} while (groupIndex != startGroup);
 
 					throw FullSubmapException();
 				}
 
+				// The entry itself stays in place until compaction, so iterators and references
+				// handed out before the erase remain readable.
+				bool erase(const Key& key, std::size_t hash1, std::size_t hash2)
+				{
+					const std::pair<std::size_t, bool> findResult = find(key, hash1, hash2);
+					if (!findResult.second) {
+						return false;
+					}
+
+					uint8_t expected = make_tag(hash1);
+					if (!get_ctrl(findResult.first).compare_exchange_strong(expected, CTRL_DELETED, std::memory_order_acq_rel)) {
+						return false;	// erased by someone else
+					}
+					num_deleted_buckets.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+
 				bool is_overloaded() const noexcept {
 					return (float)get_num_valid_buckets() / get_capacity() >= maxload_factor;
 				}
@@ -260,27 +701,62 @@ namespace noname_core {
 
 					stats.capacity = get_capacity();
 					stats.num_valid_buckets = get_num_valid_buckets();
+					stats.num_deleted_buckets = get_num_deleted_buckets();
 					stats.load_factor = (float)stats.num_valid_buckets / stats.capacity;
+					stats.tombstone_ratio = stats.num_valid_buckets ? (float)stats.num_deleted_buckets / stats.num_valid_buckets : 0.0f;
+					stats.bucket_bytes = sizeof(Submap)
+						+ get_num_groups() * (sizeof(Group) + sizeof(std::atomic<uint32_t>))
+						+ get_capacity() * sizeof(entry);
+					stats.heap_bytes = 0;
 
 					return stats;
 				}
 			};
 
+			// The submap directory is allocated in chunks of 8, 16, 32, ... slots. expand() allocates a
+			// chunk before publishing the submap count that reaches into it, so readers never see the
+			// directory move and a small map only pays for the first chunk.
+			static constexpr std::size_t DIRECTORY_FIRST_CHUNK = 8;
+			static constexpr std::size_t DIRECTORY_NUM_CHUNKS = 16;
+			static constexpr std::size_t DIRECTORY_CAPACITY = DIRECTORY_FIRST_CHUNK * ((std::size_t(1) << DIRECTORY_NUM_CHUNKS) - 1);
+
 			float maxload_factor;
+			Growth_policy growthPolicy;
 			std::atomic<std::size_t> num_submaps;
-			std::vector<std::unique_ptr<Submap> > submaps;
+			std::unique_ptr<std::unique_ptr<Submap>[]> directory[DIRECTORY_NUM_CHUNKS];
 			std::atomic<std::size_t> num_entries;
 			std::atomic_flag expanding;
 
 			std::size_t get_maxnum_submaps() const noexcept {
-				return submaps.size();
+				return growthPolicy.max_num_submaps;
+			}
+
+			static std::size_t get_directory_chunk(std::size_t index) noexcept {
+				return highest_bit_index(static_cast<uint32_t>(index / DIRECTORY_FIRST_CHUNK + 1));
+			}
+
+			static std::size_t get_directory_chunk_begin(std::size_t chunk) noexcept {
+				return DIRECTORY_FIRST_CHUNK * ((std::size_t(1) << chunk) - 1);
+			}
+
+			void allocate_directory(std::size_t index) {
+				const std::size_t chunk = get_directory_chunk(index);
+				if (!directory[chunk]) {
+					directory[chunk].reset(new std::unique_ptr<Submap>[DIRECTORY_FIRST_CHUNK << chunk]);
+				}
 			}
 
 			std::unique_ptr<Submap>& get_submap(std::size_t index) {
-				return submaps[index];
+				const std::size_t chunk = get_directory_chunk(index);
+				return directory[chunk][index - get_directory_chunk_begin(chunk)];
 			}
 			const std::unique_ptr<Submap>& get_submap(std::size_t index) const {
-				return submaps[index];
+				const std::size_t chunk = get_directory_chunk(index);
+				return directory[chunk][index - get_directory_chunk_begin(chunk)];
+			}
+
+			Submap* make_submap(std::size_t capacity) const {
+				return new Submap(capacity, maxload_factor, growthPolicy.power_of_two && growthPolicy.growth_factor >= 2.0f);
 			}
 
 			std::size_t get_num_submaps() const noexcept {
@@ -299,6 +775,58 @@ namespace noname_core {
 				num_entries.fetch_add(1, std::memory_order_relaxed);
 			}
 
+			void decrementnum_entries() noexcept {
+				num_entries.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			std::size_t get_submap_capacity_for(std::size_t numEntries) const noexcept {
+				return std::max(FIRST_SUBMAP_MIN_CAPACITY, (std::size_t) (numEntries / maxload_factor) + 1);
+			}
+
+			// moves the live entries of all submaps into one new submap; the map must not be in use
+			void rehash(std::size_t capacity)
+			{
+				std::unique_ptr<Submap> rehashed(make_submap(capacity));
+
+				for (std::size_t submapIndex = 0; submapIndex < get_num_submaps(); submapIndex++) {
+					Submap& submap = *get_submap(submapIndex);
+
+					for (std::size_t bucketIndex = 0; submap.seek(bucketIndex); bucketIndex++) {
+						entry& e = submap.get_entry(bucketIndex);
+						const std::pair<std::size_t, std::size_t> hashes = hash_key(e.first);
+						rehashed->insert(std::move(e.first), hashes.first, hashes.second, [&e](const Key&) -> Value&& { return std::move(e.second); });
+					}
+				}
+				reset_submaps(rehashed.release());
+			}
+
+			static Growth_policy make_growth_policy(std::size_t maxnum_submaps) noexcept {
+				Growth_policy policy;
+				policy.max_num_submaps = maxnum_submaps;
+				return policy;
+			}
+
+			// moves the submaps and entry count of other here, dropping ours and leaving other without any
+			void take_submaps(concurrent_unordered_map& other) noexcept {
+				for (std::size_t chunk = 0; chunk < DIRECTORY_NUM_CHUNKS; chunk++) {
+					directory[chunk] = std::move(other.directory[chunk]);
+				}
+				num_submaps.store(other.get_num_submaps(), std::memory_order_release);
+				num_entries.store(other.get_num_entries(), std::memory_order_relaxed);
+
+				other.num_submaps.store(0, std::memory_order_release);
+				other.num_entries.store(0, std::memory_order_relaxed);
+			}
+
+			void reset_submaps(Submap* firstSubmap) {
+				allocate_directory(0);
+				for (std::size_t submapIndex = 1; submapIndex < get_num_submaps(); submapIndex++) {
+					get_submap(submapIndex).reset();
+				}
+				get_submap(0).reset(firstSubmap);
+				num_submaps.store(1, std::memory_order_release);
+			}
+
 			bool expand() 
 			{
 				while (expanding.test_and_set(std::memory_order_acquire)) {
@@ -308,16 +836,35 @@ namespace noname_core {
 				bool result = false;
 				const std::size_t num_submapsSnapshot = get_num_submaps();
 
+				// a moved-from map gets its first submap on the first insert
+				if (num_submapsSnapshot == 0) {
+					allocate_directory(0);
+					get_submap(0).reset(make_submap(FIRST_SUBMAP_MIN_CAPACITY));
+					increment_num_submaps();
+					expanding.clear(std::memory_order_release);
+					return true;
+				}
+
 				if (num_submapsSnapshot == get_maxnum_submaps()) {
+					expanding.clear(std::memory_order_release);
 					throw std::runtime_error("Error: reached the maximum number of submaps: " + std::to_string(get_maxnum_submaps()));
 				}
 
 				const std::size_t lastSubmapIndex = num_submapsSnapshot - 1;
-				const Submap& lastSubmap = *get_submap(lastSubmapIndex);
+				Submap& lastSubmap = *get_submap(lastSubmapIndex);
 
 				if (lastSubmap.is_overloaded()) {
-					const std::size_t newSubmapCapacity = next_prime(lastSubmap.get_capacity() * NEW_SUBMAPS_CAPACITY_MULTIPLIER);
-					get_submap(lastSubmapIndex + 1).reset(new Submap(newSubmapCapacity, maxload_factor));
+					lastSubmap.sealed.store(true);
+					while (lastSubmap.writers.load() != 0) {
+						std::this_thread::yield();
+					}
+
+					// at least one group more, however close to 1 the factor is
+					const std::size_t newSubmapCapacity = std::max(
+						lastSubmap.get_capacity() + GROUP_SIZE,
+						(std::size_t) (lastSubmap.get_capacity() * growthPolicy.growth_factor));
+					allocate_directory(lastSubmapIndex + 1);
+					get_submap(lastSubmapIndex + 1).reset(make_submap(newSubmapCapacity));
 					increment_num_submaps();
 					result = true;
 				}
@@ -340,12 +887,8 @@ namespace noname_core {
 					return *map->get_submap(submapIndex);
 				}
 
-				const Bucket& get_bucket() const {
-					return get_submap().get_bucket(bucketIndex);
-				}
-
 				const entry& get_entry() const {
-					return get_bucket().entry;
+					return get_submap().get_entry(bucketIndex);
 				}
 
 				void seek()
@@ -375,7 +918,7 @@ namespace noname_core {
 					map(map),
 					submapIndex(0),
 					bucketIndex(0),
-					end(end) {
+					end(end || !map->get_num_submaps()) {
 					seek();
 				}
 
@@ -442,20 +985,48 @@ namespace noname_core {
 				return end();
 			}
 
+			template<typename Function>
+			void update_entry(const const_iterator& it, Function&& fn)
+			{
+				Submap& submap = *get_submap(it.submapIndex);
+				const std::size_t groupIndex = it.bucketIndex / GROUP_SIZE;
+
+				submap.lock_group(groupIndex);
+				try {
+					fn(const_cast<Value&>(it->second));
+				}
+				catch (...) {
+					submap.unlock_group(groupIndex);
+					throw;
+				}
+				submap.unlock_group(groupIndex);
+			}
+
+			std::size_t erase_helper(const Key& key, std::size_t hash1, std::size_t hash2)
+			{
+				for (long submapIndex = get_last_submap_index(); submapIndex >= 0; submapIndex--) {
+					Submap& submap = *get_submap(submapIndex);
+
+					if (submap.erase(key, hash1, hash2)) {
+						decrementnum_entries();
+						return 1;
+					}
+				}
+				return 0;
+			}
+
 			template<typename KeyType, typename ValueType>
 			std::pair<const_iterator, bool> insert_helper(KeyType&& key, std::size_t hash1, std::size_t hash2, ValueType ivalue)
 			{
 
 				while (1) {
-					const std::size_t lastSubmapIndex = get_last_submap_index();
-
-					if (lastSubmapIndex > 0) {
-						const const_iterator findIterator = find_helper(key, hash1, hash2, lastSubmapIndex - 1);
-						if (findIterator != end()) {
-							return std::make_pair(findIterator, false);
-						}
+					const std::size_t num_submapsSnapshot = get_num_submaps();
+					if (num_submapsSnapshot == 0) {
+						expand();
+						continue;
 					}
 
+					const std::size_t lastSubmapIndex = num_submapsSnapshot - 1;
 					Submap& lastSubmap = *get_submap(lastSubmapIndex);
 
 					if (lastSubmap.is_overloaded()) {
@@ -463,8 +1034,24 @@ namespace noname_core {
 						continue;
 					}
 
+					lastSubmap.writers.fetch_add(1);
+					if (lastSubmap.sealed.load()) {
+						lastSubmap.writers.fetch_sub(1);
+						std::this_thread::yield();
+						continue;
+					}
+
+					if (lastSubmapIndex > 0) {
+						const const_iterator findIterator = find_helper(key, hash1, hash2, lastSubmapIndex - 1);
+						if (findIterator != end()) {
+							lastSubmap.writers.fetch_sub(1);
+							return std::make_pair(findIterator, false);
+						}
+					}
+
 					try {
 						const std::pair<std::size_t, bool> insertResult = lastSubmap.insert(std::forward<KeyType>(key), hash1, hash2, ivalue);
+						lastSubmap.writers.fetch_sub(1);
 
 						if (insertResult.second) {
 							incrementnum_entries();
@@ -474,6 +1061,7 @@ namespace noname_core {
 						return std::make_pair(insertIterator, insertResult.second);
 					}
 					catch (typename Submap::FullSubmapException&) {
+						lastSubmap.writers.fetch_sub(1);
 						expand();
 						continue;
 					}
@@ -486,9 +1074,14 @@ namespace noname_core {
 			concurrent_unordered_map(std::size_t estimatednum_entries = 0,
 				float maxload_factor = DEFAULT_MAX_LOAD_FACTOR,
 				std::size_t maxnum_submaps = DEFAULT_MAX_NUM_SUBMAPS) :
+				concurrent_unordered_map(estimatednum_entries, maxload_factor, make_growth_policy(maxnum_submaps)) { }
+
+			concurrent_unordered_map(std::size_t estimatednum_entries,
+				float maxload_factor,
+				const Growth_policy& growthPolicy) :
 				maxload_factor(maxload_factor),
+				growthPolicy(growthPolicy),
 				num_submaps(1),
-				submaps(maxnum_submaps),
 				num_entries(0) {
 
 				expanding.clear();
@@ -497,19 +1090,25 @@ namespace noname_core {
 					throw std::logic_error("Invalid maximum load factor");
 				}
 
-				if (maxnum_submaps < 1) {
+				if (growthPolicy.max_num_submaps < 1 || growthPolicy.max_num_submaps > DIRECTORY_CAPACITY) {
 					throw std::logic_error("Invalid maximum number of submaps");
 				}
 
+				if (!(growthPolicy.growth_factor > 1.0f)) {
+					throw std::logic_error("Invalid growth factor");
+				}
+
 				const std::size_t firstSubmapCapacity = std::max(
 					FIRST_SUBMAP_MIN_CAPACITY,
-					next_prime((std::size_t) (FIRST_SUBMAP_CAPACITY_MULTIPLIER * estimatednum_entries / maxload_factor)));
+					(std::size_t) (FIRST_SUBMAP_CAPACITY_MULTIPLIER * estimatednum_entries / maxload_factor));
 
-				get_submap(0).reset(new Submap(firstSubmapCapacity, maxload_factor));
+				allocate_directory(0);
+				get_submap(0).reset(make_submap(firstSubmapCapacity));
 			}
 
 			const_iterator find(const Key& key) const {
-				return find_helper(key, keyHash1(key), keyHash2(key), get_last_submap_index());
+				const std::pair<std::size_t, std::size_t> hashes = hash_key(key);
+				return find_helper(key, hashes.first, hashes.second, get_last_submap_index());
 			}
 
 			const Value& at(const Key& key) const {
@@ -524,14 +1123,16 @@ namespace noname_core {
 				return at(key);
 			}
 
-			template<typename Value>
-			std::pair<const_iterator, bool> insert(const Key& key, Value ivalue) {
-				return insert_helper(key, keyHash1(key), keyHash2(key), ivalue);
+			template<typename ValueType>
+			std::pair<const_iterator, bool> insert(const Key& key, ValueType ivalue) {
+				const std::pair<std::size_t, std::size_t> hashes = hash_key(key);
+				return insert_helper(key, hashes.first, hashes.second, ivalue);
 			}
 
-			template<typename Value>
-			std::pair<const_iterator, bool> insert(Key&& key, Value ivalue) {
-				return insert_helper(std::move(key), keyHash1(key), keyHash2(key), ivalue);
+			template<typename ValueType>
+			std::pair<const_iterator, bool> insert(Key&& key, ValueType ivalue) {
+				const std::pair<std::size_t, std::size_t> hashes = hash_key(key);
+				return insert_helper(std::move(key), hashes.first, hashes.second, ivalue);
 			}
 
 			std::pair<const_iterator, bool> insert(const entry& entry) {
@@ -547,6 +1148,139 @@ namespace noname_core {
 				return insert(entry(std::forward<Args>(args)...));
 			}
 
+			// the probe hashes of a key, for callers that hash ahead of upsert_batch
+			hash_pair get_hashes(const Key& key) const {
+				return hash_key(key);
+			}
+
+			// For each i < count: inserts keys[i] with makeValue(i) when it is missing, then calls
+			// update(i, value) on its entry. The control bytes and first candidate entry of a window
+			// of keys are prefetched before any of them is touched, so the cache misses overlap.
+			// hashes, when given, must come from get_hashes. update runs under the entry's group
+			// lock, like update() below.
+			template<typename MakeValue, typename Update>
+			void upsert_batch(const Key* keys, std::size_t count, MakeValue makeValue, Update update, const hash_pair* hashes = nullptr)
+			{
+				hash_pair windowHashes[UPSERT_BATCH_WINDOW];
+
+				for (std::size_t windowBegin = 0; windowBegin < count; windowBegin += UPSERT_BATCH_WINDOW) {
+					const std::size_t windowSize = std::min(UPSERT_BATCH_WINDOW, count - windowBegin);
+					const std::size_t num_submapsSnapshot = get_num_submaps();
+					const std::size_t firstPrefetched = num_submapsSnapshot > UPSERT_BATCH_PREFETCH_SUBMAPS
+						? num_submapsSnapshot - UPSERT_BATCH_PREFETCH_SUBMAPS : 0;
+
+					for (std::size_t i = 0; i < windowSize; i++) {
+						windowHashes[i] = hashes ? hashes[windowBegin + i] : hash_key(keys[windowBegin + i]);
+						for (std::size_t submapIndex = firstPrefetched; submapIndex < num_submapsSnapshot; submapIndex++) {
+							get_submap(submapIndex)->prefetch_group(windowHashes[i].first);
+						}
+					}
+
+					for (std::size_t i = 0; i < windowSize; i++) {
+						for (std::size_t submapIndex = firstPrefetched; submapIndex < num_submapsSnapshot; submapIndex++) {
+							get_submap(submapIndex)->prefetch_entry(windowHashes[i].first);
+						}
+					}
+
+					for (std::size_t i = 0; i < windowSize; i++) {
+						const std::size_t index = windowBegin + i;
+						const const_iterator it = insert_helper(keys[index], windowHashes[i].first, windowHashes[i].second,
+							[&makeValue, index](const Key&) -> Value { return makeValue(index); }).first;
+						update_entry(it, [&update, index](Value& value) { update(index, value); });
+					}
+				}
+			}
+
+			// Calls fn(value) on the entry of key and returns false when there is none. Updates through
+			// update() and upsert_batch() hold the entry's group seqlock, so they are serialized per
+			// group and snapshot readers never see one half done.
+			template<typename Function>
+			bool update(const Key& key, Function fn)
+			{
+				const const_iterator it = find(key);
+				if (it == end()) {
+					return false;
+				}
+				update_entry(it, fn);
+				return true;
+			}
+
+			// Calls fn(key, value) for every entry, with each group's values copied between two updates,
+			// so a reporter can read counters while writers keep going. Each entry is coherent; entries
+			// of different groups may be from different moments. Values must be trivially copyable.
+			template<typename Function>
+			void for_each_snapshot(Function fn) const
+			{
+				Value values[GROUP_SIZE];
+
+				for (std::size_t submapIndex = 0; submapIndex < get_num_submaps(); submapIndex++) {
+					const Submap& submap = *get_submap(submapIndex);
+
+					for (std::size_t groupIndex = 0; groupIndex < submap.get_num_groups(); groupIndex++) {
+						for (uint32_t mask = submap.read_group(groupIndex, values); mask; mask &= mask - 1) {
+							const unsigned slot = lowest_bit_index(mask);
+							fn(submap.get_entry(groupIndex * GROUP_SIZE + slot).first, static_cast<const Value&>(values[slot]));
+						}
+					}
+				}
+			}
+
+			std::vector<entry> snapshot() const
+			{
+				std::vector<entry> entries;
+				entries.reserve(get_num_entries());
+				for_each_snapshot([&entries](const Key& key, const Value& value) { entries.emplace_back(key, value); });
+				return entries;
+			}
+
+			// Safe to call alongside find and insert.
+			std::size_t erase(const Key& key) {
+				const std::pair<std::size_t, std::size_t> hashes = hash_key(key);
+				return erase_helper(key, hashes.first, hashes.second);
+			}
+
+			// Drops every entry and every submap but the first, which is replaced by an empty one
+			// of the same capacity. No other operation may run on the map meanwhile.
+			void clear()
+			{
+				if (get_num_submaps() == 0) {
+					return;
+				}
+
+				const Submap& firstSubmap = *get_submap(0);
+				reset_submaps(make_submap(firstSubmap.get_capacity()));
+				num_entries.store(0, std::memory_order_relaxed);
+			}
+
+			// Rehashes the live entries of all submaps into a single submap sized for them, which drops
+			// tombstones and shortens find() back to one probe sequence after a burst of growth.
+			// No other operation may run on the map meanwhile.
+			void compact()
+			{
+				const std::size_t num_submapsSnapshot = get_num_submaps();
+				if (num_submapsSnapshot == 0 || (num_submapsSnapshot == 1 && get_submap(0)->get_num_deleted_buckets() == 0)) {
+					return;
+				}
+
+				rehash(get_submap_capacity_for((std::size_t) (COMPACTED_SUBMAP_CAPACITY_MULTIPLIER * get_num_entries())));
+			}
+
+			// Makes room for numEntries entries in total, so that inserting up to that many grows no
+			// further submap. Rehashes into a single submap when needed. No other operation may run
+			// on the map meanwhile.
+			void reserve(std::size_t numEntries)
+			{
+				numEntries = std::max(numEntries, get_num_entries());
+
+				if (get_num_submaps() == 1) {
+					const Submap& submap = *get_submap(0);
+					if (submap.get_num_valid_buckets() + (numEntries - get_num_entries()) <= submap.get_capacity() * maxload_factor) {
+						return;
+					}
+				}
+				rehash(get_submap_capacity_for(numEntries));
+			}
+
 			std::size_t get_num_entries() const noexcept {
 				return num_entries.load(std::memory_order_relaxed);
 			}
@@ -575,39 +1309,219 @@ namespace noname_core {
 				return end();
 			}
 
+			// Calls fn(entry) for every entry in partition `partition` of `num_partitions`. The partitions
+			// split the buckets of all submaps into contiguous, group-aligned ranges of similar size, so
+			// each caller thread can take one. Entries inserted meanwhile may or may not be visited.
+			template<typename Function>
+			void for_each_in_partition(std::size_t partition, std::size_t num_partitions, Function fn) const
+			{
+				const std::size_t num_submapsSnapshot = get_num_submaps();
+				std::size_t totalGroups = 0;
+				for (std::size_t submapIndex = 0; submapIndex < num_submapsSnapshot; submapIndex++) {
+					totalGroups += get_submap(submapIndex)->get_num_groups();
+				}
+
+				const std::size_t firstBucket = totalGroups * partition / num_partitions * GROUP_SIZE;
+				const std::size_t lastBucket = totalGroups * (partition + 1) / num_partitions * GROUP_SIZE;
+				std::size_t submapBegin = 0;
+
+				for (std::size_t submapIndex = 0; submapIndex < num_submapsSnapshot && submapBegin < lastBucket; submapIndex++) {
+					const Submap& submap = *get_submap(submapIndex);
+					const std::size_t submapEnd = submapBegin + submap.get_capacity();
+
+					if (submapEnd > firstBucket) {
+						std::size_t bucketIndex = std::max(firstBucket, submapBegin) - submapBegin;
+						const std::size_t endIndex = std::min(lastBucket, submapEnd) - submapBegin;
+
+						for (; submap.seek(bucketIndex, endIndex); bucketIndex++) {
+							fn(submap.get_entry(bucketIndex));
+						}
+					}
+					submapBegin = submapEnd;
+				}
+			}
+
+			// Runs fn(partition, entry) over num_partitions partitions, one thread each (the calling
+			// thread takes partition 0). The first exception thrown by fn is rethrown after all joined.
+			template<typename Function>
+			void for_each_partition(std::size_t num_partitions, Function fn) const
+			{
+				if (num_partitions < 1) {
+					throw std::logic_error("Invalid number of partitions");
+				}
+
+				std::vector<std::exception_ptr> errors(num_partitions);
+				const auto run = [&](std::size_t partition) {
+					try {
+						for_each_in_partition(partition, num_partitions, [&](const entry& e) { fn(partition, e); });
+					}
+					catch (...) {
+						errors[partition] = std::current_exception();
+					}
+				};
+
+				std::vector<std::thread> threads;
+				for (std::size_t partition = 1; partition < num_partitions; partition++) {
+					threads.emplace_back(run, partition);
+				}
+				run(0);
+
+				for (auto& t : threads) {
+					t.join();
+				}
+				for (auto& error : errors) {
+					if (error) std::rethrow_exception(error);
+				}
+			}
+
+			// one partition per hardware thread once the map is large enough to pay for the threads
+			std::size_t get_default_num_partitions() const noexcept {
+				if (get_num_entries() < PARALLEL_TRAVERSAL_MIN_ENTRIES) {
+					return 1;
+				}
+				return std::max(1u, std::thread::hardware_concurrency());
+			}
+
+			// The result has the load factor, growth policy and hashers of this map.
 			template<typename FilterFunction>
 			concurrent_unordered_map* filter(FilterFunction filterFunction) const
 			{
-				concurrent_unordered_map* map = new concurrent_unordered_map(get_num_entries());
+				return parallel_filter(1, filterFunction);
+			}
 
-				for (const entry& entry : *this) {
+			// Like filter(), with filterFunction called from num_partitions threads at once, so it
+			// must be safe to share; get_default_num_partitions() suits a stateless predicate.
+			template<typename FilterFunction>
+			concurrent_unordered_map* parallel_filter(std::size_t num_partitions, FilterFunction filterFunction) const
+			{
+				std::unique_ptr<concurrent_unordered_map> map(new concurrent_unordered_map(get_num_entries(), maxload_factor, growthPolicy));
+				map->keyHash1 = keyHash1;
+				map->keyHash2 = keyHash2;
+
+				for_each_partition(num_partitions, [&](std::size_t, const entry& entry) {
 					if (filterFunction(entry)) {
 						map->insert(entry);
 					}
-				}
-				return map;
+				});
+				return map.release();
 			}
 
 			concurrent_unordered_map* clone() const {
-				return filter([](const entry&) { return true; });
+				return new concurrent_unordered_map(*this);
 			}
 
-			Stats get_stats() const 
+			// scanEntries also fills heap_bytes and the probe length histograms, rehashing every key;
+			// it reads entries the way an iterator does.
+			Stats get_stats(bool scanEntries = false) const 
 			{
 				Stats stats;
 
 				stats.num_entries = get_num_entries();
 				stats.num_submaps = get_num_submaps();
+				stats.directory_bytes = 0;
+				for (std::size_t chunk = 0; chunk < DIRECTORY_NUM_CHUNKS; chunk++) {
+					if (directory[chunk]) {
+						stats.directory_bytes += (DIRECTORY_FIRST_CHUNK << chunk) * sizeof(std::unique_ptr<Submap>);
+					}
+				}
+				stats.total_bytes = sizeof(*this) + stats.directory_bytes;
+
 				for (std::size_t submapIndex = 0; submapIndex < stats.num_submaps; submapIndex++) {
 					const Submap& submap = *get_submap(submapIndex);
-					stats.submaps_stats.push_back(submap.get_stats());
+					Submap_stats submapStats = submap.get_stats();
+
+					if (scanEntries) {
+						submapStats.probe_length_histogram.assign(PROBE_HISTOGRAM_SIZE, 0);
+
+						for (std::size_t bucketIndex = 0; submap.seek(bucketIndex); bucketIndex++) {
+							const entry& e = submap.get_entry(bucketIndex);
+							const std::pair<std::size_t, std::size_t> hashes = hash_key(e.first);
+							const std::size_t probeLength = submap.get_probe_length(hashes.first, hashes.second, bucketIndex / GROUP_SIZE);
+
+							submapStats.probe_length_histogram[std::min(probeLength, PROBE_HISTOGRAM_SIZE) - 1]++;
+							submapStats.heap_bytes += Heap_usage<Key>::get_bytes(e.first) + Heap_usage<Value>::get_bytes(e.second);
+						}
+					}
+
+					stats.total_bytes += submapStats.bucket_bytes + submapStats.heap_bytes;
+					stats.submaps_stats.push_back(std::move(submapStats));
 				}
 				return stats;
 			}
 
-			// TODO: make move and copy
-			concurrent_unordered_map(concurrent_unordered_map&&) = delete;
-			concurrent_unordered_map(const concurrent_unordered_map&) = delete;
+			// Copying, moving and swapping need exclusive access to every map involved. A moved-from
+			// map is empty and usable: it keeps no submap and allocates a minimal one on the next insert.
+			concurrent_unordered_map(const concurrent_unordered_map& other)
+				: concurrent_unordered_map(other.get_num_entries(), other.maxload_factor, other.growthPolicy)
+			{
+				keyHash1 = other.keyHash1;
+				keyHash2 = other.keyHash2;
+
+				other.for_each_partition(other.get_default_num_partitions(), [this](std::size_t, const entry& e) {
+					insert(e);
+				});
+			}
+
+			concurrent_unordered_map(concurrent_unordered_map&& other)
+				noexcept(std::is_nothrow_move_constructible<KeyHash1>::value && std::is_nothrow_move_constructible<KeyHash2>::value)
+				: keyHash1(std::move(other.keyHash1))
+				, keyHash2(std::move(other.keyHash2))
+				, maxload_factor(other.maxload_factor)
+				, growthPolicy(other.growthPolicy)
+				, num_submaps(0)
+				, num_entries(0)
+			{
+				expanding.clear();
+				take_submaps(other);
+			}
+
+			concurrent_unordered_map& operator=(const concurrent_unordered_map& other)
+			{
+				if (this != &other) {
+					concurrent_unordered_map copy(other);
+					swap(copy);
+				}
+				return *this;
+			}
+
+			concurrent_unordered_map& operator=(concurrent_unordered_map&& other)
+				noexcept(std::is_nothrow_move_assignable<KeyHash1>::value && std::is_nothrow_move_assignable<KeyHash2>::value)
+			{
+				if (this != &other) {
+					keyHash1 = std::move(other.keyHash1);
+					keyHash2 = std::move(other.keyHash2);
+					maxload_factor = other.maxload_factor;
+					growthPolicy = other.growthPolicy;
+					take_submaps(other);
+				}
+				return *this;
+			}
+
+			// Exchanges the contents in O(1), e.g. to rotate a full table out for export once the
+			// workers filling it have stopped.
+			void swap(concurrent_unordered_map& other)
+			{
+				using std::swap;
+				swap(keyHash1, other.keyHash1);
+				swap(keyHash2, other.keyHash2);
+				swap(maxload_factor, other.maxload_factor);
+				swap(growthPolicy, other.growthPolicy);
+				swap(directory, other.directory);
+
+				const std::size_t num_submapsSnapshot = get_num_submaps();
+				num_submaps.store(other.get_num_submaps(), std::memory_order_release);
+				other.num_submaps.store(num_submapsSnapshot, std::memory_order_release);
+
+				const std::size_t num_entriesSnapshot = get_num_entries();
+				num_entries.store(other.get_num_entries(), std::memory_order_relaxed);
+				other.num_entries.store(num_entriesSnapshot, std::memory_order_relaxed);
+			}
 		};
+
+		template<typename Key, typename Value, typename KeyHash1, typename KeyHash2, typename key_equal>
+		void swap(concurrent_unordered_map<Key, Value, KeyHash1, KeyHash2, key_equal>& a, concurrent_unordered_map<Key, Value, KeyHash1, KeyHash2, key_equal>& b)
+		{
+			a.swap(b);
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <tuple>
+#include <array>
+#include <functional>
+#include <type_traits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace noname_core {
+	namespace concurrent {
+		namespace hash_detail {
+			constexpr uint64_t SECRET0 = 0xa0761d6478bd642full;
+			constexpr uint64_t SECRET1 = 0xe7037ed1a0b428dbull;
+			constexpr uint64_t SECRET2 = 0x8ebc6af09c88c6dbull;
+			constexpr uint64_t SECRET3 = 0x589965cc75374cc3ull;
+
+			// 64x64 -> 128 bit multiply, low half in a, high half in b
+			inline void mum(uint64_t& a, uint64_t& b) noexcept
+			{
+#if defined(__SIZEOF_INT128__)
+				const unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+				a = static_cast<uint64_t>(r);
+				b = static_cast<uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+				a = _umul128(a, b, &b);
+#else
+				const uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+				const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+				const uint64_t t = rl + (rm0 << 32);
+				uint64_t c = t < rl;
+				const uint64_t lo = t + (rm1 << 32);
+				c += lo < t;
+				b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+				a = lo;
+#endif
+			}
+
+			inline uint64_t mix(uint64_t a, uint64_t b) noexcept
+			{
+				mum(a, b);
+				return a ^ b;
+			}
+
+			inline uint64_t read8(const uint8_t* p) noexcept { uint64_t v; std::memcpy(&v, p, 8); return v; }
+			inline uint64_t read4(const uint8_t* p) noexcept { uint32_t v; std::memcpy(&v, p, 4); return v; }
+			inline uint64_t read3(const uint8_t* p, std::size_t k) noexcept
+			{
+				return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+			}
+		}
+
+		// wyhash (final version 4) over a byte range; no allocation, one multiply per 16 bytes
+		inline uint64_t hash_bytes(const void* key, std::size_t len, uint64_t seed = 0) noexcept
+		{
+			using namespace hash_detail;
+
+			const uint8_t* p = static_cast<const uint8_t*>(key);
+			seed ^= mix(seed ^ SECRET0, SECRET1);
+			uint64_t a, b;
+
+			if (len <= 16) {
+				if (len >= 4) {
+					a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+					b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+				}
+				else if (len > 0) {
+					a = read3(p, len);
+					b = 0;
+				}
+				else {
+					a = b = 0;
+				}
+			}
+			else {
+				std::size_t i = len;
+				if (i > 48) {
+					uint64_t see1 = seed, see2 = seed;
+					do {
+						seed = mix(read8(p) ^ SECRET1, read8(p + 8) ^ seed);
+						see1 = mix(read8(p + 16) ^ SECRET2, read8(p + 24) ^ see1);
+						see2 = mix(read8(p + 32) ^ SECRET3, read8(p + 40) ^ see2);
+						p += 48;
+						i -= 48;
+					} while (i > 48);
+					seed ^= see1 ^ see2;
+				}
+				while (i > 16) {
+					seed = mix(read8(p) ^ SECRET1, read8(p + 8) ^ seed);
+					i -= 16;
+					p += 16;
+				}
+				a = read8(p + i - 16);
+				b = read8(p + i - 8);
+			}
+
+			a ^= SECRET1;
+			b ^= seed;
+			mum(a, b);
+			return mix(a ^ SECRET0 ^ len, b ^ SECRET1);
+		}
+
+		inline uint64_t hash_int(uint64_t key, uint64_t seed = 0) noexcept
+		{
+			return hash_detail::mix(key ^ seed ^ hash_detail::SECRET0, hash_detail::SECRET1);
+		}
+
+		inline uint64_t hash_combine(uint64_t seed, uint64_t hash) noexcept
+		{
+			return hash_detail::mix(seed ^ hash_detail::SECRET2, hash ^ hash_detail::SECRET3);
+		}
+
+		// Default key hash of concurrent_unordered_map. Every bit of the result depends on every bit
+		// of the key (the map relies on that, see is_avalanching); types without a specialization
+		// fall back to std::hash and the map mixes the result itself.
+		template<typename Key, typename Enable = void>
+		struct Hash {
+			std::size_t operator()(const Key& key) const {
+				return std::hash<Key>()(key);
+			}
+		};
+
+		template<typename Key>
+		struct Hash<Key, typename std::enable_if<std::is_integral<Key>::value || std::is_enum<Key>::value>::type> {
+			using is_avalanching = void;
+
+			std::size_t operator()(const Key& key) const noexcept {
+				return static_cast<std::size_t>(hash_int(static_cast<uint64_t>(key)));
+			}
+		};
+
+		template<>
+		struct Hash<std::string_view> {
+			using is_avalanching = void;
+
+			std::size_t operator()(std::string_view key) const noexcept {
+				return static_cast<std::size_t>(hash_bytes(key.data(), key.size()));
+			}
+		};
+
+		template<>
+		struct Hash<std::string> {
+			using is_avalanching = void;
+
+			std::size_t operator()(const std::string& key) const noexcept {
+				return static_cast<std::size_t>(hash_bytes(key.data(), key.size()));
+			}
+		};
+
+		// fixed-width binary keys (addresses, MACs, packed flow keys) are hashed as one byte range
+		template<typename T, std::size_t N>
+		struct Hash<std::array<T, N>, typename std::enable_if<std::is_integral<T>::value>::type> {
+			using is_avalanching = void;
+
+			std::size_t operator()(const std::array<T, N>& key) const noexcept {
+				return static_cast<std::size_t>(hash_bytes(key.data(), N * sizeof(T)));
+			}
+		};
+
+		template<typename T1, typename T2>
+		struct Hash<std::pair<T1, T2>> {
+			using is_avalanching = void;
+
+			std::size_t operator()(const std::pair<T1, T2>& key) const {
+				return static_cast<std::size_t>(hash_combine(Hash<T1>()(key.first), Hash<T2>()(key.second)));
+			}
+		};
+
+		template<typename... Ts>
+		struct Hash<std::tuple<Ts...>> {
+			using is_avalanching = void;
+
+			std::size_t operator()(const std::tuple<Ts...>& key) const {
+				return hash(key, std::index_sequence_for<Ts...>());
+			}
+
+		private:
+			template<std::size_t... I>
+			static std::size_t hash(const std::tuple<Ts...>& key, std::index_sequence<I...>) {
+				uint64_t h = hash_detail::SECRET0;
+				((h = hash_combine(h, Hash<typename std::tuple_element<I, std::tuple<Ts...>>::type>()(std::get<I>(key)))), ...);
+				return static_cast<std::size_t>(h);
+			}
+		};
+
+		template<typename KeyHash, typename = void>
+		struct is_avalanching : std::false_type { };
+
+		template<typename KeyHash>
+		struct is_avalanching<KeyHash, std::void_t<typename KeyHash::is_avalanching>> : std::true_type { };
+	}
+}
\ No newline at end of file
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <stdexcept>
+#include <string>
+
+#include <pcap.h>
+
+namespace noname_core {
+	namespace filter {
+		// Evaluates a compiled bpf_program with the same semantics as libpcap's bpf_filter().
+		// The program is validated and pre-decoded once: every (class, size, mode, src) combination
+		// becomes one dense opcode, jump offsets become absolute indices, and the common
+		// "ld [k]; jeq/jset #v" pairs are fused into single instructions. Evaluation is a tight
+		// switch over that array with no per-instruction decoding.
+		class bpf_evaluator {
+		private:
+			enum class Op : uint8_t {
+				LD_W_ABS, LD_H_ABS, LD_B_ABS,
+				LD_W_IND, LD_H_IND, LD_B_IND,
+				LD_W_LEN, LD_IMM, LD_MEM,
+				LDX_IMM, LDX_MEM, LDX_LEN, LDX_MSH,
+				ST, STX,
+				ADD_K, SUB_K, MUL_K, DIV_K, MOD_K, AND_K, OR_K, XOR_K, LSH_K, RSH_K,
+				ADD_X, SUB_X, MUL_X, DIV_X, MOD_X, AND_X, OR_X, XOR_X, LSH_X, RSH_X,
+				NEG,
+				JA,
+				JEQ_K, JGT_K, JGE_K, JSET_K,
+				JEQ_X, JGT_X, JGE_X, JSET_X,
+				LD_H_ABS_JEQ, LD_B_ABS_JEQ, LD_W_ABS_JEQ,
+				LD_H_ABS_JSET, LD_B_ABS_JSET, LD_W_ABS_JSET,
+				RET_K, RET_A,
+				TAX, TXA
+			};
+
+			struct instruction {
+				Op op;
+				uint32_t k;
+				uint32_t jt;	// absolute index of the taken branch
+				uint32_t jf;
+				uint32_t k2;	// comparison constant of a fused load + jump
+			};
+
+			std::vector<instruction> code;
+
+			static Op decode(uint16_t code, uint32_t k, std::size_t pc);
+			void fuse();
+
+		public:
+			bpf_evaluator() = default;
+			explicit bpf_evaluator(const struct bpf_program& program);
+
+			// Returns the snap length the program accepts (0 means the packet is rejected).
+			uint32_t run(const uint8_t* packet, uint32_t wirelen, uint32_t buflen) const;
+
+			bool match(const struct pcap_pkthdr* header, const uint8_t* packet) const
+			{
+				return run(packet, header->len, header->caplen) != 0;
+			}
+
+			bool empty() const noexcept
+			{
+				return code.empty();
+			}
+		};
+
+		inline bpf_evaluator::Op bpf_evaluator::decode(uint16_t code, uint32_t k, std::size_t pc)
+		{
+			switch (code) {
+			case BPF_LD | BPF_W | BPF_ABS:	return Op::LD_W_ABS;
+			case BPF_LD | BPF_H | BPF_ABS:	return Op::LD_H_ABS;
+			case BPF_LD | BPF_B | BPF_ABS:	return Op::LD_B_ABS;
+			case BPF_LD | BPF_W | BPF_IND:	return Op::LD_W_IND;
+			case BPF_LD | BPF_H | BPF_IND:	return Op::LD_H_IND;
+			case BPF_LD | BPF_B | BPF_IND:	return Op::LD_B_IND;
+			case BPF_LD | BPF_W | BPF_LEN:	return Op::LD_W_LEN;
+			case BPF_LD | BPF_IMM:			return Op::LD_IMM;
+			case BPF_LD | BPF_MEM:			return Op::LD_MEM;
+			case BPF_LDX | BPF_W | BPF_IMM:	return Op::LDX_IMM;
+			case BPF_LDX | BPF_W | BPF_MEM:	return Op::LDX_MEM;
+			case BPF_LDX | BPF_W | BPF_LEN:	return Op::LDX_LEN;
+			case BPF_LDX | BPF_B | BPF_MSH:	return Op::LDX_MSH;
+			case BPF_ST:					return Op::ST;
+			case BPF_STX:					return Op::STX;
+
+			case BPF_ALU | BPF_ADD | BPF_K:	return Op::ADD_K;
+			case BPF_ALU | BPF_SUB | BPF_K:	return Op::SUB_K;
+			case BPF_ALU | BPF_MUL | BPF_K:	return Op::MUL_K;
+			case BPF_ALU | BPF_DIV | BPF_K:
+				if (k == 0) throw std::invalid_argument("bpf: division by zero at " + std::to_string(pc));
+				return Op::DIV_K;
+			case BPF_ALU | BPF_MOD | BPF_K:
+				if (k == 0) throw std::invalid_argument("bpf: modulo by zero at " + std::to_string(pc));
+				return Op::MOD_K;
+			case BPF_ALU | BPF_AND | BPF_K:	return Op::AND_K;
+			case BPF_ALU | BPF_OR | BPF_K:	return Op::OR_K;
+			case BPF_ALU | BPF_XOR | BPF_K:	return Op::XOR_K;
+			case BPF_ALU | BPF_LSH | BPF_K:
+				if (k >= 32) throw std::invalid_argument("bpf: shift out of range at " + std::to_string(pc));
+				return Op::LSH_K;
+			case BPF_ALU | BPF_RSH | BPF_K:
+				if (k >= 32) throw std::invalid_argument("bpf: shift out of range at " + std::to_string(pc));
+				return Op::RSH_K;
+			case BPF_ALU | BPF_ADD | BPF_X:	return Op::ADD_X;
+			case BPF_ALU | BPF_SUB | BPF_X:	return Op::SUB_X;
+			case BPF_ALU | BPF_MUL | BPF_X:	return Op::MUL_X;
+			case BPF_ALU | BPF_DIV | BPF_X:	return Op::DIV_X;
+			case BPF_ALU | BPF_MOD | BPF_X:	return Op::MOD_X;
+			case BPF_ALU | BPF_AND | BPF_X:	return Op::AND_X;
+			case BPF_ALU | BPF_OR | BPF_X:	return Op::OR_X;
+			case BPF_ALU | BPF_XOR | BPF_X:	return Op::XOR_X;
+			case BPF_ALU | BPF_LSH | BPF_X:	return Op::LSH_X;
+			case BPF_ALU | BPF_RSH | BPF_X:	return Op::RSH_X;
+			case BPF_ALU | BPF_NEG:			return Op::NEG;
+
+			case BPF_JMP | BPF_JA:			return Op::JA;
+			case BPF_JMP | BPF_JEQ | BPF_K:	return Op::JEQ_K;
+			case BPF_JMP | BPF_JGT | BPF_K:	return Op::JGT_K;
+			case BPF_JMP | BPF_JGE | BPF_K:	return Op::JGE_K;
+			case BPF_JMP | BPF_JSET | BPF_K:	return Op::JSET_K;
+			case BPF_JMP | BPF_JEQ | BPF_X:	return Op::JEQ_X;
+			case BPF_JMP | BPF_JGT | BPF_X:	return Op::JGT_X;
+			case BPF_JMP | BPF_JGE | BPF_X:	return Op::JGE_X;
+			case BPF_JMP | BPF_JSET | BPF_X:	return Op::JSET_X;
+
+			case BPF_RET | BPF_K:			return Op::RET_K;
+			case BPF_RET | BPF_A:			return Op::RET_A;
+			case BPF_MISC | BPF_TAX:		return Op::TAX;
+			case BPF_MISC | BPF_TXA:		return Op::TXA;
+			default:
+				break;
+			}
+			throw std::invalid_argument("bpf: unsupported opcode " + std::to_string(code) + " at " + std::to_string(pc));
+		}
+
+		inline bpf_evaluator::bpf_evaluator(const struct bpf_program& program)
+		{
+			const std::size_t n = program.bf_len;
+			if (n == 0 || program.bf_insns == nullptr)
+				throw std::invalid_argument("bpf: empty program");
+
+			code.resize(n);
+
+			for (std::size_t pc = 0; pc < n; ++pc) {
+				const struct bpf_insn& insn = program.bf_insns[pc];
+				instruction& out = code[pc];
+
+				out.op = decode(insn.code, insn.k, pc);
+				out.k = insn.k;
+				out.k2 = 0;
+				out.jt = out.jf = 0;
+
+				switch (out.op) {
+				case Op::LD_MEM: case Op::LDX_MEM: case Op::ST: case Op::STX:
+					if (insn.k >= BPF_MEMWORDS)
+						throw std::invalid_argument("bpf: scratch memory index out of range at " + std::to_string(pc));
+					break;
+				case Op::JA:
+					if (insn.k >= n - pc - 1)
+						throw std::invalid_argument("bpf: jump out of range at " + std::to_string(pc));
+					out.jt = out.jf = static_cast<uint32_t>(pc + 1 + insn.k);
+					break;
+				case Op::JEQ_K: case Op::JGT_K: case Op::JGE_K: case Op::JSET_K:
+				case Op::JEQ_X: case Op::JGT_X: case Op::JGE_X: case Op::JSET_X:
+					if (pc + 1 + insn.jt >= n || pc + 1 + insn.jf >= n)
+						throw std::invalid_argument("bpf: jump out of range at " + std::to_string(pc));
+					out.jt = static_cast<uint32_t>(pc + 1 + insn.jt);
+					out.jf = static_cast<uint32_t>(pc + 1 + insn.jf);
+					break;
+				default:
+					break;
+				}
+			}
+
+			const Op last = code.back().op;
+			if (last != Op::RET_K && last != Op::RET_A)
+				throw std::invalid_argument("bpf: program does not end with a return");
+
+			fuse();
+		}
+
+		inline void bpf_evaluator::fuse()
+		{
+			// The load keeps its own slot so jumps into the comparison still land on the original
+			// instruction; only straight-line execution takes the fused path.
+			for (std::size_t pc = 0; pc + 1 < code.size(); ++pc) {
+				instruction& load = code[pc];
+				const instruction& cmp = code[pc + 1];
+
+				if (cmp.op != Op::JEQ_K && cmp.op != Op::JSET_K)
+					continue;
+
+				const bool jeq = cmp.op == Op::JEQ_K;
+				switch (load.op) {
+				case Op::LD_H_ABS: load.op = jeq ? Op::LD_H_ABS_JEQ : Op::LD_H_ABS_JSET; break;
+				case Op::LD_B_ABS: load.op = jeq ? Op::LD_B_ABS_JEQ : Op::LD_B_ABS_JSET; break;
+				case Op::LD_W_ABS: load.op = jeq ? Op::LD_W_ABS_JEQ : Op::LD_W_ABS_JSET; break;
+				default: continue;
+				}
+				load.k2 = cmp.k;
+				load.jt = cmp.jt;
+				load.jf = cmp.jf;
+			}
+		}
+
+		inline uint32_t bpf_evaluator::run(const uint8_t* p, uint32_t wirelen, uint32_t buflen) const
+		{
+			uint32_t A = 0, X = 0;
+			uint32_t mem[BPF_MEMWORDS];
+			std::size_t pc = 0;
+
+			if (code.empty())
+				return static_cast<uint32_t>(-1);	// same as libpcap: no program accepts everything
+
+			const auto load_w = [&](uint64_t off, uint32_t& out) -> bool {
+				if (off + 4 > buflen) return false;
+				out = (static_cast<uint32_t>(p[off]) << 24) | (static_cast<uint32_t>(p[off + 1]) << 16)
+					| (static_cast<uint32_t>(p[off + 2]) << 8) | p[off + 3];
+				return true;
+			};
+			const auto load_h = [&](uint64_t off, uint32_t& out) -> bool {
+				if (off + 2 > buflen) return false;
+				out = (static_cast<uint32_t>(p[off]) << 8) | p[off + 1];
+				return true;
+			};
+			const auto load_b = [&](uint64_t off, uint32_t& out) -> bool {
+				if (off + 1 > buflen) return false;
+				out = p[off];
+				return true;
+			};
+
+			while (1) {
+				const instruction& i = code[pc];
+
+				switch (i.op) {
+				case Op::LD_W_ABS: if (!load_w(i.k, A)) return 0; ++pc; break;
+				case Op::LD_H_ABS: if (!load_h(i.k, A)) return 0; ++pc; break;
+				case Op::LD_B_ABS: if (!load_b(i.k, A)) return 0; ++pc; break;
+				case Op::LD_W_IND: if (!load_w(static_cast<uint64_t>(X) + i.k, A)) return 0; ++pc; break;
+				case Op::LD_H_IND: if (!load_h(static_cast<uint64_t>(X) + i.k, A)) return 0; ++pc; break;
+				case Op::LD_B_IND: if (!load_b(static_cast<uint64_t>(X) + i.k, A)) return 0; ++pc; break;
+				case Op::LD_W_LEN: A = wirelen; ++pc; break;
+				case Op::LD_IMM: A = i.k; ++pc; break;
+				case Op::LD_MEM: A = mem[i.k]; ++pc; break;
+				case Op::LDX_IMM: X = i.k; ++pc; break;
+				case Op::LDX_MEM: X = mem[i.k]; ++pc; break;
+				case Op::LDX_LEN: X = wirelen; ++pc; break;
+				case Op::LDX_MSH:
+					if (i.k >= buflen) return 0;
+					X = (p[i.k] & 0x0F) << 2;
+					++pc; break;
+				case Op::ST: mem[i.k] = A; ++pc; break;
+				case Op::STX: mem[i.k] = X; ++pc; break;
+
+				case Op::ADD_K: A += i.k; ++pc; break;
+				case Op::SUB_K: A -= i.k; ++pc; break;
+				case Op::MUL_K: A *= i.k; ++pc; break;
+				case Op::DIV_K: A /= i.k; ++pc; break;
+				case Op::MOD_K: A %= i.k; ++pc; break;
+				case Op::AND_K: A &= i.k; ++pc; break;
+				case Op::OR_K: A |= i.k; ++pc; break;
+				case Op::XOR_K: A ^= i.k; ++pc; break;
+				case Op::LSH_K: A <<= i.k; ++pc; break;
+				case Op::RSH_K: A >>= i.k; ++pc; break;
+				case Op::ADD_X: A += X; ++pc; break;
+				case Op::SUB_X: A -= X; ++pc; break;
+				case Op::MUL_X: A *= X; ++pc; break;
+				case Op::DIV_X: if (X == 0) return 0; A /= X; ++pc; break;
+				case Op::MOD_X: if (X == 0) return 0; A %= X; ++pc; break;
+				case Op::AND_X: A &= X; ++pc; break;
+				case Op::OR_X: A |= X; ++pc; break;
+				case Op::XOR_X: A ^= X; ++pc; break;
+				case Op::LSH_X: A = X < 32 ? A << X : 0; ++pc; break;
+				case Op::RSH_X: A = X < 32 ? A >> X : 0; ++pc; break;
+				case Op::NEG: A = 0u - A; ++pc; break;
+
+				case Op::JA: pc = i.jt; break;
+				case Op::JEQ_K: pc = A == i.k ? i.jt : i.jf; break;
+				case Op::JGT_K: pc = A > i.k ? i.jt : i.jf; break;
+				case Op::JGE_K: pc = A >= i.k ? i.jt : i.jf; break;
+				case Op::JSET_K: pc = (A & i.k) ? i.jt : i.jf; break;
+				case Op::JEQ_X: pc = A == X ? i.jt : i.jf; break;
+				case Op::JGT_X: pc = A > X ? i.jt : i.jf; break;
+				case Op::JGE_X: pc = A >= X ? i.jt : i.jf; break;
+				case Op::JSET_X: pc = (A & X) ? i.jt : i.jf; break;
+
+				case Op::LD_H_ABS_JEQ: if (!load_h(i.k, A)) return 0; pc = A == i.k2 ? i.jt : i.jf; break;
+				case Op::LD_B_ABS_JEQ: if (!load_b(i.k, A)) return 0; pc = A == i.k2 ? i.jt : i.jf; break;
+				case Op::LD_W_ABS_JEQ: if (!load_w(i.k, A)) return 0; pc = A == i.k2 ? i.jt : i.jf; break;
+				case Op::LD_H_ABS_JSET: if (!load_h(i.k, A)) return 0; pc = (A & i.k2) ? i.jt : i.jf; break;
+				case Op::LD_B_ABS_JSET: if (!load_b(i.k, A)) return 0; pc = (A & i.k2) ? i.jt : i.jf; break;
+				case Op::LD_W_ABS_JSET: if (!load_w(i.k, A)) return 0; pc = (A & i.k2) ? i.jt : i.jf; break;
+
+				case Op::RET_K: return i.k;
+				case Op::RET_A: return A;
+				case Op::TAX: X = A; ++pc; break;
+				case Op::TXA: A = X; ++pc; break;
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
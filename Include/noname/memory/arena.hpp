@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+namespace noname_core {
+	namespace memory {
+		namespace {
+			constexpr std::size_t DEFAULT_ARENA_BLOCK_SIZE = 64 * 1024;
+		}
+
+		// Bump allocator. Memory is only released when the arena is destroyed or reset.
+		class arena {
+		private:
+			std::vector<std::unique_ptr<uint8_t[]>> blocks;
+			std::size_t block_size;
+			std::size_t used;
+			std::size_t capacity;
+			std::size_t bytes_allocated;
+
+		public:
+			explicit arena(std::size_t block_size = DEFAULT_ARENA_BLOCK_SIZE)
+				: block_size(block_size)
+				, used(0)
+				, capacity(0)
+				, bytes_allocated(0) { }
+
+			arena(arena&&) = default;
+			arena& operator=(arena&&) = default;
+			arena(const arena&) = delete;
+			arena& operator=(const arena&) = delete;
+
+			void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+			{
+				std::size_t offset = (used + alignment - 1) & ~(alignment - 1);
+
+				if (blocks.empty() || offset + size > capacity) {
+					// new[] returns memory aligned for any fundamental type, so a fresh block starts at 0
+					capacity = std::max(block_size, size);
+					blocks.emplace_back(new uint8_t[capacity]);
+					bytes_allocated += capacity;
+					offset = 0;
+				}
+
+				used = offset + size;
+				return blocks.back().get() + offset;
+			}
+
+			void reset()
+			{
+				blocks.clear();
+				used = 0;
+				capacity = 0;
+				bytes_allocated = 0;
+			}
+
+			std::size_t get_bytes_allocated() const noexcept
+			{
+				return bytes_allocated;
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <cstring>
+#include <string_view>
+#include <functional>
+
+namespace noname_core {
+	namespace memory {
+		// Interns strings into an arena and hands out dense 32-bit ids.
+		// Repeated strings cost one hash lookup and no allocation.
+		class string_table {
+		public:
+			typedef uint32_t id_type;
+
+			static constexpr id_type INVALID_ID = 0xFFFFFFFFu;
+
+		private:
+			struct Slot {
+				id_type id;
+				uint32_t hash;
+			};
+
+			arena storage;
+			std::vector<std::string_view> strings;
+			std::vector<Slot> slots;
+			std::size_t mask;
+
+			static uint32_t hash_of(std::string_view s) noexcept
+			{
+				const uint64_t h = std::hash<std::string_view>()(s);
+				return static_cast<uint32_t>(h ^ (h >> 32));
+			}
+
+			void grow()
+			{
+				std::vector<Slot> old(std::move(slots));
+				slots.assign(old.size() * 2, Slot{ INVALID_ID, 0 });
+				mask = slots.size() - 1;
+
+				for (const Slot& s : old) {
+					if (s.id == INVALID_ID) continue;
+					std::size_t index = s.hash & mask;
+					while (slots[index].id != INVALID_ID)
+						index = (index + 1) & mask;
+					slots[index] = s;
+				}
+			}
+
+		public:
+			explicit string_table(std::size_t initial_capacity = 1024)
+			{
+				std::size_t capacity = 16;
+				while (capacity < initial_capacity * 2) capacity <<= 1;
+				slots.assign(capacity, Slot{ INVALID_ID, 0 });
+				mask = capacity - 1;
+			}
+
+			id_type find(std::string_view s) const noexcept
+			{
+				const uint32_t hash = hash_of(s);
+				std::size_t index = hash & mask;
+
+				while (slots[index].id != INVALID_ID) {
+					if (slots[index].hash == hash && strings[slots[index].id] == s)
+						return slots[index].id;
+					index = (index + 1) & mask;
+				}
+				return INVALID_ID;
+			}
+
+			id_type intern(std::string_view s)
+			{
+				const uint32_t hash = hash_of(s);
+				std::size_t index = hash & mask;
+
+				while (slots[index].id != INVALID_ID) {
+					if (slots[index].hash == hash && strings[slots[index].id] == s)
+						return slots[index].id;
+					index = (index + 1) & mask;
+				}
+
+				char* copy = static_cast<char*>(storage.allocate(s.size() + 1, 1));
+				memcpy(copy, s.data(), s.size());
+				copy[s.size()] = '\0';
+
+				const id_type id = static_cast<id_type>(strings.size());
+				strings.emplace_back(copy, s.size());
+				slots[index] = Slot{ id, hash };
+
+				if (strings.size() * 2 > slots.size())
+					grow();
+				return id;
+			}
+
+			std::string_view get(id_type id) const
+			{
+				return strings[id];
+			}
+
+			std::size_t size() const noexcept
+			{
+				return strings.size();
+			}
+
+			std::size_t get_bytes_allocated() const noexcept
+			{
+				return storage.get_bytes_allocated()
+					+ strings.capacity() * sizeof(std::string_view)
+					+ slots.capacity() * sizeof(Slot);
+			}
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "layers.hpp"
+#include "scan.hpp"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace noname_core {
+	namespace network {
+		constexpr std::size_t MAX_BATCH_SIZE = 256;
+
+		// Structure-of-arrays view of the headers of up to MAX_BATCH_SIZE packets.
+		// Every column follows parse_layers(): fields of a layer that is absent or malformed are 0.
+		struct header_columns {
+			alignas(32) uint16_t ether_type[MAX_BATCH_SIZE];
+			alignas(32) uint8_t  ip_proto[MAX_BATCH_SIZE];
+			alignas(32) uint32_t src_addr[MAX_BATCH_SIZE];
+			alignas(32) uint32_t des_addr[MAX_BATCH_SIZE];
+			alignas(32) uint16_t src_port[MAX_BATCH_SIZE];
+			alignas(32) uint16_t des_port[MAX_BATCH_SIZE];
+			alignas(32) uint16_t l3_offset[MAX_BATCH_SIZE];
+			alignas(32) uint16_t l4_offset[MAX_BATCH_SIZE];
+			alignas(32) uint16_t payload_offset[MAX_BATCH_SIZE];
+			alignas(32) uint32_t payload_length[MAX_BATCH_SIZE];
+		};
+
+		inline void parse_packet_scalar(const uint8_t* data, uint32_t caplen, header_columns& out, std::size_t i)
+		{
+			packet_layers layers;
+			const bool has_ether = parse_layers(data, caplen, layers);
+
+			out.ether_type[i] = has_ether ? ethernet_view(data).get_ether_type() : 0;
+			out.l3_offset[i] = layers.l3_offset;
+			out.l4_offset[i] = layers.l4_offset;
+			out.payload_offset[i] = layers.payload_offset;
+			out.payload_length[i] = layers.payload_length;
+
+			if (layers.has_l3()) {
+				const ip_view ip(data + layers.l3_offset);
+				out.ip_proto[i] = ip.get_proto();
+				out.src_addr[i] = ip.get_src_addr();
+				out.des_addr[i] = ip.get_des_addr();
+			}
+			else {
+				out.ip_proto[i] = 0;
+				out.src_addr[i] = out.des_addr[i] = 0;
+			}
+
+			if (layers.has_l4()) {
+				out.src_port[i] = load_be16(data + layers.l4_offset);
+				out.des_port[i] = load_be16(data + layers.l4_offset + 2);
+			}
+			else {
+				out.src_port[i] = out.des_port[i] = 0;
+			}
+		}
+
+#ifdef __AVX2__
+		namespace {
+			// Gathers one unaligned 32-bit word from packets[lane] + offset[lane] for 8 lanes.
+			// Lanes outside mask are not read and come back as 0.
+			inline __m256i batch_gather32(__m256i ptr_lo, __m256i ptr_hi, __m256i offset, __m256i mask)
+			{
+				const __m256i addr_lo = _mm256_add_epi64(ptr_lo, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(offset)));
+				const __m256i addr_hi = _mm256_add_epi64(ptr_hi, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(offset, 1)));
+
+				const __m128i lo = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), static_cast<const int*>(nullptr),
+					addr_lo, _mm256_castsi256_si128(mask), 1);
+				const __m128i hi = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), static_cast<const int*>(nullptr),
+					addr_hi, _mm256_extracti128_si256(mask, 1), 1);
+				return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+			}
+
+			// first two bytes of each little-endian gathered word as a big-endian 16-bit value
+			inline __m256i batch_be16_lo(__m256i w)
+			{
+				return _mm256_or_si256(
+					_mm256_slli_epi32(_mm256_and_si256(w, _mm256_set1_epi32(0xFF)), 8),
+					_mm256_and_si256(_mm256_srli_epi32(w, 8), _mm256_set1_epi32(0xFF)));
+			}
+
+			inline __m256i batch_be16_hi(__m256i w)
+			{
+				return batch_be16_lo(_mm256_srli_epi32(w, 16));
+			}
+
+			inline __m256i batch_bswap32(__m256i w)
+			{
+				const __m256i shuffle = _mm256_setr_epi8(
+					3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+					3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+				return _mm256_shuffle_epi8(w, shuffle);
+			}
+
+			// unsigned a <= b for 32-bit lanes
+			inline __m256i batch_le_epu32(__m256i a, __m256i b)
+			{
+				return _mm256_cmpeq_epi32(_mm256_min_epu32(a, b), a);
+			}
+
+			inline void batch_store16(uint16_t* dst, __m256i v)
+			{
+				const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(packed));
+			}
+
+			inline void batch_store8(uint8_t* dst, __m256i v)
+			{
+				const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+				const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(packed), _mm256_castsi256_si128(packed));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), bytes);
+			}
+
+			inline void batch_store32(uint32_t* dst, __m256i v)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v);
+			}
+		}
+
+		// Decodes 8 packets at once. Lanes shorter than ethernet + a minimal IPv4 header are
+		// left to the scalar path because no 32-bit gather can read them safely.
+		inline void parse_packets_avx2(const uint8_t* const* packets, const uint32_t* caplens, header_columns& out, std::size_t i)
+		{
+			const __m256i ptr_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packets + i));
+			const __m256i ptr_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(packets + i + 4));
+			const __m256i caplen = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(caplens + i));
+
+			const __m256i zero = _mm256_setzero_si256();
+
+			const __m256i eth_len = _mm256_set1_epi32(static_cast<int>(ethernet_view::LEN));
+			const __m256i min_l3 = _mm256_set1_epi32(static_cast<int>(ethernet_view::LEN + ip_view::MIN_LEN));
+			const __m256i wide = batch_le_epu32(min_l3, caplen);
+
+			const __m256i w12 = batch_gather32(ptr_lo, ptr_hi, _mm256_set1_epi32(12), wide);
+			const __m256i w16 = batch_gather32(ptr_lo, ptr_hi, _mm256_set1_epi32(16), wide);
+			const __m256i w20 = batch_gather32(ptr_lo, ptr_hi, _mm256_set1_epi32(20), wide);
+			const __m256i w26 = batch_gather32(ptr_lo, ptr_hi, _mm256_set1_epi32(26), wide);
+			const __m256i w30 = batch_gather32(ptr_lo, ptr_hi, _mm256_set1_epi32(30), wide);
+
+			const __m256i ether_type = batch_be16_lo(w12);
+			const __m256i ver_ihl = _mm256_and_si256(_mm256_srli_epi32(w12, 16), _mm256_set1_epi32(0xFF));
+			const __m256i version = _mm256_srli_epi32(ver_ihl, 4);
+			const __m256i ip_len = _mm256_slli_epi32(_mm256_and_si256(ver_ihl, _mm256_set1_epi32(0x0F)), 2);
+			const __m256i ip_total = batch_be16_lo(w16);
+			const __m256i frag = _mm256_and_si256(batch_be16_lo(w20), _mm256_set1_epi32(0x1FFF));
+			const __m256i proto = _mm256_srli_epi32(w20, 24);
+
+			const __m256i l4 = _mm256_add_epi32(eth_len, ip_len);
+
+			__m256i has_l3 = _mm256_and_si256(wide, _mm256_cmpeq_epi32(ether_type, _mm256_set1_epi32(ethernet_header::ETHER_TYPE_IP)));
+			has_l3 = _mm256_and_si256(has_l3, _mm256_cmpeq_epi32(version, _mm256_set1_epi32(4)));
+			has_l3 = _mm256_and_si256(has_l3, batch_le_epu32(_mm256_set1_epi32(static_cast<int>(ip_view::MIN_LEN)), ip_len));
+			has_l3 = _mm256_and_si256(has_l3, batch_le_epu32(l4, caplen));
+			has_l3 = _mm256_and_si256(has_l3, batch_le_epu32(ip_len, ip_total));
+
+			const __m256i end = _mm256_min_epu32(caplen, _mm256_add_epi32(eth_len, ip_total));
+			const __m256i first_fragment = _mm256_and_si256(has_l3, _mm256_cmpeq_epi32(frag, zero));
+
+			const __m256i is_tcp = _mm256_and_si256(first_fragment, _mm256_cmpeq_epi32(proto, _mm256_set1_epi32(ip_header::IP_PROTO_TCP)));
+			const __m256i is_udp = _mm256_and_si256(first_fragment, _mm256_cmpeq_epi32(proto, _mm256_set1_epi32(ip_header::IP_PROTO_UDP)));
+
+			const __m256i tcp_min = _mm256_and_si256(is_tcp, batch_le_epu32(_mm256_add_epi32(l4, _mm256_set1_epi32(static_cast<int>(tcp_view::MIN_LEN))), end));
+			const __m256i w_doff = batch_gather32(ptr_lo, ptr_hi, _mm256_add_epi32(l4, _mm256_set1_epi32(12)), tcp_min);
+			const __m256i tcp_len = _mm256_slli_epi32(_mm256_srli_epi32(_mm256_and_si256(w_doff, _mm256_set1_epi32(0xF0)), 4), 2);
+			const __m256i tcp_payload = _mm256_add_epi32(l4, tcp_len);
+			const __m256i tcp_ok = _mm256_and_si256(tcp_min, _mm256_and_si256(
+				batch_le_epu32(_mm256_set1_epi32(static_cast<int>(tcp_view::MIN_LEN)), tcp_len),
+				batch_le_epu32(tcp_payload, end)));
+
+			const __m256i udp_payload = _mm256_add_epi32(l4, _mm256_set1_epi32(static_cast<int>(udp_view::LEN)));
+			const __m256i udp_ok = _mm256_and_si256(is_udp, batch_le_epu32(udp_payload, end));
+
+			const __m256i has_l4 = _mm256_or_si256(tcp_ok, udp_ok);
+			const __m256i payload = _mm256_or_si256(_mm256_and_si256(tcp_ok, tcp_payload), _mm256_and_si256(udp_ok, udp_payload));
+			const __m256i w_ports = batch_gather32(ptr_lo, ptr_hi, l4, has_l4);
+
+			batch_store16(out.ether_type + i, _mm256_and_si256(wide, ether_type));
+			batch_store8(out.ip_proto + i, _mm256_and_si256(has_l3, proto));
+			batch_store32(out.src_addr + i, _mm256_and_si256(has_l3, batch_bswap32(w26)));
+			batch_store32(out.des_addr + i, _mm256_and_si256(has_l3, batch_bswap32(w30)));
+			batch_store16(out.l3_offset + i, _mm256_and_si256(has_l3, eth_len));
+			batch_store16(out.l4_offset + i, _mm256_and_si256(has_l4, l4));
+			batch_store16(out.payload_offset + i, payload);
+			batch_store32(out.payload_length + i, _mm256_and_si256(has_l4, _mm256_sub_epi32(end, payload)));
+			batch_store16(out.src_port + i, batch_be16_lo(w_ports));
+			batch_store16(out.des_port + i, batch_be16_hi(w_ports));
+
+			uint32_t narrow = ~static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(wide))) & 0xFF;
+			while (narrow) {
+				const unsigned lane = count_trailing_zeros(narrow);
+				parse_packet_scalar(packets[i + lane], caplens[i + lane], out, i + lane);
+				narrow &= narrow - 1;
+			}
+		}
+#endif
+
+		// Decodes the headers of count (<= MAX_BATCH_SIZE) packets into columns.
+		// Uses 8-wide AVX2 gathers when the build enables AVX2 and the scalar parser otherwise.
+		inline void parse_batch(const uint8_t* const* packets, const uint32_t* caplens, std::size_t count, header_columns& out)
+		{
+			std::size_t i = 0;
+
+#ifdef __AVX2__
+			for (; i + 8 <= count; i += 8)
+				parse_packets_avx2(packets, caplens, out, i);
+#endif
+
+			for (; i < count; ++i)
+				parse_packet_scalar(packets[i], caplens[i], out, i);
+		}
+	}
+}
\ No newline at end of file
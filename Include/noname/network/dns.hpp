@@ -0,0 +1,315 @@
+#pragma once
+
+#include "header.hpp"
+#include "flow.hpp"
+#include "utils.hpp"
+#include "../memory/string_table.hpp"
+
+#include <unordered_map>
+#include <string_view>
+#include <limits>
+
+namespace noname_core {
+	namespace network {
+		constexpr std::size_t DNS_HEADER_LEN = 12;
+		constexpr std::size_t DNS_MAX_NAME_LEN = 255;
+
+		constexpr uint8_t DNS_RCODE_NOERROR = 0;
+		constexpr uint8_t DNS_RCODE_SERVFAIL = 2;
+		constexpr uint8_t DNS_RCODE_NXDOMAIN = 3;
+
+		struct dns_message {
+			uint16_t	id = 0;
+			bool		is_response = false;
+			uint8_t		opcode = 0;
+			uint8_t		rcode = 0;
+			uint16_t	question_count = 0;
+			uint16_t	qtype = 0;
+			uint16_t	qclass = 0;
+			std::size_t	name_length = 0;
+			char		name[DNS_MAX_NAME_LEN + 1] = { 0 };
+
+			std::string_view get_name() const { return std::string_view(name, name_length); }
+		};
+
+		// QR bit of a header at least DNS_HEADER_LEN long
+		inline bool is_dns_response(const uint8_t* data)
+		{
+			return (data[2] & 0x80) != 0;
+		}
+
+		// Decodes a (possibly compressed) name starting at offset into out, lowercased and dot separated.
+		// Every read is checked against len and pointer chains are bounded, so malformed packets fail cleanly.
+		inline bool decode_dns_name(const uint8_t* data, std::size_t len, std::size_t offset,
+			char* out, std::size_t& out_len, std::size_t& next_offset)
+		{
+			constexpr int MAX_JUMPS = 64;
+
+			int jumps = 0;
+			bool jumped = false;
+			out_len = 0;
+
+			while (1) {
+				if (offset >= len) return false;
+				const uint8_t label = data[offset];
+
+				if (label == 0) {
+					if (!jumped) next_offset = offset + 1;
+					break;
+				}
+
+				if ((label & 0xC0) == 0xC0) {
+					if (offset + 1 >= len || ++jumps > MAX_JUMPS) return false;
+					if (!jumped) next_offset = offset + 2;
+					jumped = true;
+					offset = ((label & 0x3F) << 8) | data[offset + 1];
+					continue;
+				}
+
+				if (label & 0xC0) return false;
+				if (offset + 1 + label > len) return false;
+				if (out_len + label + (out_len ? 1 : 0) > DNS_MAX_NAME_LEN) return false;
+
+				if (out_len) out[out_len++] = '.';
+				for (uint8_t i = 0; i < label; ++i) {
+					char c = static_cast<char>(data[offset + 1 + i]);
+					if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+					out[out_len++] = c;
+				}
+				offset += 1 + label;
+			}
+
+			out[out_len] = '\0';
+			return true;
+		}
+
+		// Parses the DNS header and the first question.
+		inline bool parse_dns(const uint8_t* data, std::size_t len, dns_message& msg)
+		{
+			if (len < DNS_HEADER_LEN) return false;
+
+			const uint16_t flags = (data[2] << 8) | data[3];
+			msg.id = (data[0] << 8) | data[1];
+			msg.is_response = (flags >> 15) != 0;
+			msg.opcode = (flags >> 11) & 0x0F;
+			msg.rcode = flags & 0x0F;
+			msg.question_count = (data[4] << 8) | data[5];
+			msg.name_length = 0;
+			msg.name[0] = '\0';
+			msg.qtype = 0;
+			msg.qclass = 0;
+
+			if (msg.question_count == 0) return true;
+
+			std::size_t offset;
+			if (!decode_dns_name(data, len, DNS_HEADER_LEN, msg.name, msg.name_length, offset)) return false;
+			if (offset + 4 > len) return false;
+
+			msg.qtype = (data[offset] << 8) | data[offset + 1];
+			msg.qclass = (data[offset + 2] << 8) | data[offset + 3];
+			return true;
+		}
+
+		// Returns the last `labels` labels of name, e.g. "www.example.com" -> "example.com" for 2.
+		inline std::string_view dns_name_suffix(std::string_view name, int labels)
+		{
+			std::size_t pos = name.size();
+			while (labels-- > 0) {
+				const std::size_t dot = pos ? name.rfind('.', pos - 1) : std::string_view::npos;
+				if (dot == std::string_view::npos) return name;
+				pos = dot;
+			}
+			return name.substr(pos + 1);
+		}
+
+		inline std::string dns_qtype_to_string(uint16_t qtype)
+		{
+			switch (qtype)
+			{
+			case 1: return "A";
+			case 2: return "NS";
+			case 5: return "CNAME";
+			case 6: return "SOA";
+			case 12: return "PTR";
+			case 15: return "MX";
+			case 16: return "TXT";
+			case 28: return "AAAA";
+			case 33: return "SRV";
+			case 65: return "HTTPS";
+			case 255: return "ANY";
+			default:
+				break;
+			}
+			return "TYPE" + std::to_string(qtype);
+		}
+
+		struct dns_pending_key {
+			flow_key flow;
+			uint16_t id;
+
+			bool operator==(const dns_pending_key& k) const { return flow == k.flow && id == k.id; }
+		};
+
+		struct dns_pending_key_hash {
+			std::size_t operator()(const dns_pending_key& k) const noexcept
+			{
+				return std::hash<flow_key>()(k.flow) ^ (k.id * 0x9E3779B97F4A7C15ull);
+			}
+		};
+
+		// Counts DNS queries per qname suffix and qtype, response codes, and query->response latency
+		// matched by (flow, transaction id). Suffixes are interned so repeated names never allocate.
+		class dns_analyzer {
+		public:
+			static constexpr int DEFAULT_SUFFIX_LABELS = 2;
+			static constexpr uint64_t PENDING_TIMEOUT_USEC = 5000000;
+			static constexpr std::size_t PENDING_SWEEP_THRESHOLD = 65536;
+
+			explicit dns_analyzer(int suffix_labels = DEFAULT_SUFFIX_LABELS)
+				: suffix_labels(suffix_labels) { }
+
+			void process(const flow_key& flow, bool to_server, const uint8_t* payload, std::size_t len, uint64_t ts_usec);
+			void merge(const dns_analyzer& other);
+
+			uint64_t get_queries() const { return queries; }
+			uint64_t get_responses() const { return responses; }
+
+			std::string to_string() const;
+
+			friend std::ostream& operator<<(std::ostream& os, const dns_analyzer& d);
+
+		private:
+			static uint64_t make_count_key(memory::string_table::id_type suffix, uint16_t qtype)
+			{
+				return (static_cast<uint64_t>(suffix) << 16) | qtype;
+			}
+
+			void sweep_pending(uint64_t now_usec);
+
+			int suffix_labels;
+			memory::string_table names;
+			std::unordered_map<uint64_t, uint64_t> query_counts;
+			std::unordered_map<dns_pending_key, uint64_t, dns_pending_key_hash> pending;
+			std::size_t next_sweep_size = PENDING_SWEEP_THRESHOLD;
+
+			uint64_t queries = 0;
+			uint64_t responses = 0;
+			uint64_t malformed = 0;
+			uint64_t unmatched = 0;
+			uint64_t rcodes[16] = { 0 };
+
+			uint64_t latency_count = 0;
+			uint64_t latency_sum_usec = 0;
+			uint64_t latency_min_usec = std::numeric_limits<uint64_t>::max();
+			uint64_t latency_max_usec = 0;
+		};
+
+		inline void dns_analyzer::process(const flow_key& flow, bool to_server, const uint8_t* payload, std::size_t len, uint64_t ts_usec)
+		{
+			dns_message msg;
+			if (!parse_dns(payload, len, msg)) {
+				malformed++;
+				return;
+			}
+
+			const dns_pending_key key{ flow, msg.id };
+
+			if (!msg.is_response) {
+				if (!to_server) return;
+				queries++;
+
+				if (msg.question_count) {
+					const auto suffix = names.intern(dns_name_suffix(msg.get_name(), suffix_labels));
+					query_counts[make_count_key(suffix, msg.qtype)]++;
+				}
+
+				if (pending.size() >= next_sweep_size)
+					sweep_pending(ts_usec);
+				pending[key] = ts_usec;
+				return;
+			}
+
+			responses++;
+			rcodes[msg.rcode]++;
+
+			auto it = pending.find(key);
+			if (it == pending.end()) {
+				unmatched++;
+				return;
+			}
+
+			const uint64_t latency = ts_usec >= it->second ? ts_usec - it->second : 0;
+			latency_count++;
+			latency_sum_usec += latency;
+			latency_min_usec = std::min(latency_min_usec, latency);
+			latency_max_usec = std::max(latency_max_usec, latency);
+			pending.erase(it);
+		}
+
+		inline void dns_analyzer::sweep_pending(uint64_t now_usec)
+		{
+			for (auto it = pending.begin(); it != pending.end();) {
+				if (now_usec > it->second && now_usec - it->second > PENDING_TIMEOUT_USEC) it = pending.erase(it);
+				else ++it;
+			}
+			// queries younger than the timeout survive; wait for the table to double before the next pass
+			next_sweep_size = std::max(PENDING_SWEEP_THRESHOLD, 2 * pending.size());
+		}
+
+		inline void dns_analyzer::merge(const dns_analyzer& other)
+		{
+			for (auto& i : other.query_counts) {
+				const auto suffix = names.intern(other.names.get(static_cast<memory::string_table::id_type>(i.first >> 16)));
+				query_counts[make_count_key(suffix, static_cast<uint16_t>(i.first))] += i.second;
+			}
+
+			queries += other.queries;
+			responses += other.responses;
+			malformed += other.malformed;
+			unmatched += other.unmatched;
+			for (int i = 0; i < 16; ++i)
+				rcodes[i] += other.rcodes[i];
+
+			latency_count += other.latency_count;
+			latency_sum_usec += other.latency_sum_usec;
+			latency_min_usec = std::min(latency_min_usec, other.latency_min_usec);
+			latency_max_usec = std::max(latency_max_usec, other.latency_max_usec);
+		}
+
+		inline std::string dns_analyzer::to_string() const
+		{
+			std::ostringstream ss;
+
+			std::vector<std::pair<uint64_t, uint64_t>> sorted(query_counts.begin(), query_counts.end());
+			std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) { return a.second > b.second; });
+
+			ss << "qname suffix\t" << "qtype\t" << "queries" << std::endl;
+			for (auto& i : sorted) {
+				ss << names.get(static_cast<memory::string_table::id_type>(i.first >> 16)) << "\t"
+					<< dns_qtype_to_string(static_cast<uint16_t>(i.first)) << "\t" << i.second << std::endl;
+			}
+			ss << std::endl;
+
+			const double nxdomain = responses ? (double)rcodes[DNS_RCODE_NXDOMAIN] / responses : 0.0;
+			const double servfail = responses ? (double)rcodes[DNS_RCODE_SERVFAIL] / responses : 0.0;
+
+			ss << "queries: " << queries << "\tresponses: " << responses
+				<< "\tunmatched responses: " << unmatched << "\tmalformed: " << malformed << std::endl
+				<< std::fixed << std::setprecision(4)
+				<< "NXDOMAIN ratio: " << nxdomain << "\tSERVFAIL ratio: " << servfail << std::endl;
+
+			if (latency_count) {
+				ss << std::setprecision(3)
+					<< "latency ms (min/avg/max): " << latency_min_usec / 1e3 << " / "
+					<< (double)latency_sum_usec / latency_count / 1e3 << " / " << latency_max_usec / 1e3 << std::endl;
+			}
+			return ss.str();
+		}
+
+		inline std::ostream& operator<<(std::ostream& os, const dns_analyzer& d)
+		{
+			os << d.to_string();
+			return os;
+		}
+	}
+}
\ No newline at end of file
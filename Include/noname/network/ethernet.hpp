@@ -2,6 +2,7 @@
 
 #include "header.hpp"
 #include "types.hpp"
+#include "utils.hpp"
 
 #include <optional>
 
@@ -71,6 +72,8 @@ namespace noname_core {
 			std::string to_string() const;
 			PacketType	get_next_packet_type() const;
 
+			static constexpr PacketType get_packet_type(uint16_t ether_type);
+
 			ethernet_header  operator+(const ethernet_header& e) const = delete;
 			ethernet_header  operator-(const ethernet_header& e) const = delete;
 			ethernet_header  operator*(const ethernet_header& e) const = delete;
@@ -84,6 +87,22 @@ namespace noname_core {
 		};
 #pragma pack(pop)
 
+		// Non-owning view over an ethernet header in packet memory.
+		// Nothing is copied on construction; each getter decodes its field in host order on access.
+		struct ethernet_view final {
+			static constexpr std::size_t LEN = 2 * mac_address::LEN + sizeof(uint16_t);
+
+			const uint8_t* data;
+
+			constexpr explicit ethernet_view(const uint8_t* data) : data(data) { }
+
+			mac_address get_destination() const { return mac_address(data); }
+			mac_address get_source() const { return mac_address(data + mac_address::LEN); }
+			constexpr uint16_t get_ether_type() const { return load_be16(data + 2 * mac_address::LEN); }
+			constexpr PacketType get_next_packet_type() const { return ethernet_header::get_packet_type(get_ether_type()); }
+			constexpr const uint8_t* get_payload() const { return data + LEN; }
+		};
+
 		inline mac_address::mac_address() : address{ 0 } {  }
 
 		inline mac_address::mac_address(const uint8_t* data) : address{ 0 }
@@ -146,7 +165,7 @@ namespace noname_core {
 		inline ethernet_header::ethernet_header(const uint8_t* data)
 			: destination(data)
 			, source(data + mac_address::LEN)
-			, ether_type(*(data + 2 * mac_address::LEN)) { }
+			, ether_type(load_be16(data + 2 * mac_address::LEN)) { }
 
 		inline ethernet_header::ethernet_header(const ethernet_header& e)
 			: destination(e.destination)
@@ -172,6 +191,11 @@ namespace noname_core {
 		}
 
 		inline PacketType ethernet_header::get_next_packet_type() const
+		{
+			return get_packet_type(ether_type);
+		}
+
+		constexpr PacketType ethernet_header::get_packet_type(uint16_t ether_type)
 		{
 			switch (ether_type)
 			{
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "header.hpp"
+
+#include <functional>
+
+namespace noname_core {
+	namespace network {
+		struct flow_key {
+			uint32_t client_ip;
+			uint32_t server_ip;
+			uint16_t client_port;
+			uint16_t server_port;
+
+			bool operator==(const flow_key& f) const;
+			bool operator!=(const flow_key& f) const;
+		};
+
+		inline bool flow_key::operator==(const flow_key& f) const
+		{
+			return client_ip == f.client_ip
+				&& server_ip == f.server_ip
+				&& client_port == f.client_port
+				&& server_port == f.server_port;
+		}
+
+		inline bool flow_key::operator!=(const flow_key& f) const
+		{
+			return !(*this == f);
+		}
+	}
+}
+
+namespace std {
+	template <>
+	struct hash<noname_core::network::flow_key> {
+		std::size_t operator()(const noname_core::network::flow_key& f) const noexcept
+		{
+			uint64_t h = (static_cast<uint64_t>(f.client_ip) << 32) | f.server_ip;
+			h ^= (static_cast<uint64_t>(f.client_port) << 16 | f.server_port) * 0x9E3779B97F4A7C15ull;
+			h ^= h >> 29;
+			h *= 0xBF58476D1CE4E5B9ull;
+			h ^= h >> 32;
+			return static_cast<std::size_t>(h);
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,371 @@
+#pragma once
+
+#include "header.hpp"
+#include "flow.hpp"
+#include "scan.hpp"
+#include "tcp.hpp"
+
+#include <map>
+#include <unordered_map>
+#include <string_view>
+
+namespace noname_core {
+	namespace network {
+		enum class HttpMethod : int {
+			Get,
+			Head,
+			Post,
+			Put,
+			Delete,
+			Connect,
+			Options,
+			Trace,
+			Patch,
+			Unknown
+		};
+
+		constexpr int HTTP_METHOD_COUNT = static_cast<int>(HttpMethod::Unknown);
+
+		// larger Content-Length values are treated as malformed rather than as a body covering the rest of the flow
+		constexpr uint64_t HTTP_MAX_CONTENT_LENGTH = uint64_t(1) << 53;
+
+		inline const char* to_string(HttpMethod method)
+		{
+			static constexpr const char* names[] = {
+				"GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE", "PATCH", "UNKNOWN"
+			};
+			return names[static_cast<int>(method)];
+		}
+
+		struct http_message {
+			bool			is_request = false;
+			bool			header_complete = false;
+			HttpMethod		method = HttpMethod::Unknown;
+			uint16_t		status_code = 0;
+			std::string_view uri;
+			std::string_view host;
+			uint64_t		content_length = 0;
+			bool			has_content_length = false;
+			std::size_t		header_length = 0;
+		};
+
+		namespace {
+			inline bool http_iequals(const uint8_t* begin, const uint8_t* end, const char* token)
+			{
+				for (; begin < end && *token; ++begin, ++token) {
+					uint8_t c = *begin;
+					if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+					if (c != static_cast<uint8_t>(*token)) return false;
+				}
+				return begin == end && *token == '\0';
+			}
+
+			inline std::string_view http_trim(const uint8_t* begin, const uint8_t* end)
+			{
+				while (begin < end && (*begin == ' ' || *begin == '\t')) ++begin;
+				while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) --end;
+				return std::string_view(reinterpret_cast<const char*>(begin), end - begin);
+			}
+
+			inline HttpMethod http_parse_method(const uint8_t* begin, const uint8_t* end)
+			{
+				const std::string_view token(reinterpret_cast<const char*>(begin), end - begin);
+				for (int i = 0; i < HTTP_METHOD_COUNT; ++i)
+					if (token == to_string(static_cast<HttpMethod>(i)))
+						return static_cast<HttpMethod>(i);
+				return HttpMethod::Unknown;
+			}
+
+			inline bool http_is_version(const uint8_t* begin, const uint8_t* end)
+			{
+				return end - begin >= 8 && memcmp(begin, "HTTP/1.", 7) == 0;
+			}
+		}
+
+		// Parses an HTTP/1.x start line and the headers that fit in [data, data + len).
+		// Returns false if the payload does not start with a request or status line.
+		inline bool parse_http(const uint8_t* data, std::size_t len, http_message& msg)
+		{
+			const uint8_t* end = data + len;
+			const uint8_t* line_end = find_crlf(data, end);
+			if (line_end == end) return false;
+
+			msg = http_message{};
+
+			if (http_is_version(data, line_end)) {
+				const uint8_t* sp = find_byte(data, line_end, ' ');
+				if (line_end - sp < 4) return false;
+
+				uint16_t status = 0;
+				for (int i = 1; i <= 3; ++i) {
+					if (sp[i] < '0' || sp[i] > '9') return false;
+					status = status * 10 + (sp[i] - '0');
+				}
+				msg.status_code = status;
+			}
+			else {
+				const uint8_t* sp1 = find_byte(data, line_end, ' ');
+				if (sp1 == line_end) return false;
+
+				msg.method = http_parse_method(data, sp1);
+				if (msg.method == HttpMethod::Unknown) return false;
+
+				const uint8_t* sp2 = find_byte(sp1 + 1, line_end, ' ');
+				if (sp2 == line_end || !http_is_version(sp2 + 1, line_end)) return false;
+
+				msg.is_request = true;
+				msg.uri = std::string_view(reinterpret_cast<const char*>(sp1 + 1), sp2 - sp1 - 1);
+			}
+
+			const uint8_t* p = line_end + 2;
+			while (p < end) {
+				const uint8_t* eol = find_crlf(p, end);
+				if (eol == end) break;
+
+				if (eol == p) {
+					msg.header_complete = true;
+					msg.header_length = eol + 2 - data;
+					break;
+				}
+
+				const uint8_t* colon = find_byte(p, eol, ':');
+				if (colon != eol) {
+					if (http_iequals(p, colon, "host")) {
+						msg.host = http_trim(colon + 1, eol);
+					}
+					else if (http_iequals(p, colon, "content-length")) {
+						const std::string_view value = http_trim(colon + 1, eol);
+						uint64_t length = 0;
+						bool valid = !value.empty();
+						for (char c : value) {
+							if (c < '0' || c > '9') { valid = false; break; }
+							length = length * 10 + (c - '0');
+							if (length > HTTP_MAX_CONTENT_LENGTH) { valid = false; break; }
+						}
+						msg.has_content_length = valid;
+						msg.content_length = valid ? length : 0;
+					}
+				}
+				p = eol + 2;
+			}
+			return true;
+		}
+
+		struct http_host_stats {
+			uint64_t requests = 0;
+			uint64_t responses = 0;
+			uint64_t client_errors = 0;
+			uint64_t server_errors = 0;
+			uint64_t request_bytes = 0;
+			uint64_t response_bytes = 0;
+			uint64_t methods[HTTP_METHOD_COUNT] = { 0 };
+
+			http_host_stats& operator+=(const http_host_stats& h);
+		};
+
+		inline http_host_stats& http_host_stats::operator+=(const http_host_stats& h)
+		{
+			requests += h.requests;
+			responses += h.responses;
+			client_errors += h.client_errors;
+			server_errors += h.server_errors;
+			request_bytes += h.request_bytes;
+			response_bytes += h.response_bytes;
+			for (int i = 0; i < HTTP_METHOD_COUNT; ++i)
+				methods[i] += h.methods[i];
+			return *this;
+		}
+
+		struct http_flow_state {
+			std::string host;
+			bool head_request = false;
+			uint64_t body_left[2] = { 0, 0 };	// indexed by to_server
+			uint64_t last_ts_usec = 0;
+		};
+
+		// Aggregates HTTP/1.x requests and responses per host and per status code.
+		// Responses and body segments are attributed to the host of the last request seen on the flow.
+		// Segments inside a Content-Length body are counted without being parsed. Flow state is dropped
+		// on RST or a server FIN, and flows idle for FLOW_TIMEOUT_USEC are swept.
+		class http_analyzer {
+		public:
+			static constexpr uint64_t FLOW_TIMEOUT_USEC = 60000000;
+			static constexpr std::size_t FLOW_SWEEP_THRESHOLD = 65536;
+
+			void process(const flow_key& flow, bool to_server, uint8_t tcp_flags, const uint8_t* payload, std::size_t len, uint64_t ts_usec);
+			void merge(const http_analyzer& other);
+
+			uint64_t get_total_requests() const { return total_requests; }
+			uint64_t get_total_responses() const { return total_responses; }
+
+			std::string to_string() const;
+
+			friend std::ostream& operator<<(std::ostream& os, const http_analyzer& h);
+
+		private:
+			void process_payload(const flow_key& flow, bool to_server, const uint8_t* payload, std::size_t len, uint64_t ts_usec);
+			void sweep_flows(uint64_t now_usec);
+
+			static uint64_t get_body_left(const http_message& msg, std::size_t len);
+			static void add_bytes(http_host_stats& stats, bool to_server, uint64_t len);
+
+			std::unordered_map<std::string, http_host_stats> hosts;
+			std::map<uint16_t, uint64_t> status_codes;
+			std::unordered_map<flow_key, http_flow_state> flows;
+			std::size_t next_sweep_size = FLOW_SWEEP_THRESHOLD;
+
+			uint64_t total_requests = 0;
+			uint64_t total_responses = 0;
+			uint64_t first_ts_usec = 0;
+			uint64_t last_ts_usec = 0;
+		};
+
+		inline void http_analyzer::process(const flow_key& flow, bool to_server, uint8_t tcp_flags, const uint8_t* payload, std::size_t len, uint64_t ts_usec)
+		{
+			if (len != 0) {
+				if (first_ts_usec == 0 || ts_usec < first_ts_usec) first_ts_usec = ts_usec;
+				if (ts_usec > last_ts_usec) last_ts_usec = ts_usec;
+
+				process_payload(flow, to_server, payload, len, ts_usec);
+			}
+
+			// a client FIN may only half-close the flow before the response, so it is left to the sweep
+			if ((tcp_flags & tcp_header::TCP_FLAG_RST) || ((tcp_flags & tcp_header::TCP_FLAG_FIN) && !to_server))
+				flows.erase(flow);
+		}
+
+		inline void http_analyzer::process_payload(const flow_key& flow, bool to_server, const uint8_t* payload, std::size_t len, uint64_t ts_usec)
+		{
+			auto it = flows.find(flow);
+
+			if (it != flows.end()) {
+				http_flow_state& state = it->second;
+				state.last_ts_usec = ts_usec;
+
+				uint64_t& body_left = state.body_left[to_server];
+				if (body_left) {
+					const uint64_t body = std::min<uint64_t>(body_left, len);
+					body_left -= body;
+					add_bytes(hosts[state.host], to_server, body);
+
+					// a pipelined message may start right after the body
+					payload += body;
+					len -= static_cast<std::size_t>(body);
+					if (len == 0) return;
+				}
+			}
+
+			http_message msg;
+			const bool parsed = parse_http(payload, len, msg);
+
+			if (parsed && msg.is_request && to_server) {
+				if (it == flows.end()) {
+					if (flows.size() >= next_sweep_size)
+						sweep_flows(ts_usec);
+					it = flows.emplace(flow, http_flow_state{}).first;
+				}
+
+				http_flow_state& state = it->second;
+				state.host.assign(msg.host.data(), msg.host.size());
+				state.head_request = msg.method == HttpMethod::Head;
+				state.body_left[true] = get_body_left(msg, len);
+				state.last_ts_usec = ts_usec;
+
+				http_host_stats& stats = hosts[state.host];
+				stats.requests++;
+				stats.methods[static_cast<int>(msg.method)]++;
+				stats.request_bytes += len;
+				total_requests++;
+				return;
+			}
+
+			http_host_stats& stats = hosts[it != flows.end() ? it->second.host : std::string()];
+			add_bytes(stats, to_server, len);
+
+			if (parsed && !msg.is_request && !to_server) {
+				stats.responses++;
+				if (msg.status_code >= 400 && msg.status_code < 500) stats.client_errors++;
+				else if (msg.status_code >= 500) stats.server_errors++;
+				status_codes[msg.status_code]++;
+				total_responses++;
+
+				if (it != flows.end()) {
+					const bool no_body = it->second.head_request || msg.status_code / 100 == 1
+						|| msg.status_code == 204 || msg.status_code == 304;
+					it->second.body_left[false] = no_body ? 0 : get_body_left(msg, len);
+				}
+			}
+		}
+
+		inline void http_analyzer::sweep_flows(uint64_t now_usec)
+		{
+			for (auto it = flows.begin(); it != flows.end();) {
+				if (now_usec > it->second.last_ts_usec && now_usec - it->second.last_ts_usec > FLOW_TIMEOUT_USEC) it = flows.erase(it);
+				else ++it;
+			}
+			next_sweep_size = std::max(FLOW_SWEEP_THRESHOLD, 2 * flows.size());
+		}
+
+		// body bytes of msg that follow this segment
+		inline uint64_t http_analyzer::get_body_left(const http_message& msg, std::size_t len)
+		{
+			if (!msg.header_complete || !msg.has_content_length) return 0;
+
+			const uint64_t body = len - msg.header_length;
+			return msg.content_length > body ? msg.content_length - body : 0;
+		}
+
+		inline void http_analyzer::add_bytes(http_host_stats& stats, bool to_server, uint64_t len)
+		{
+			if (to_server) stats.request_bytes += len;
+			else stats.response_bytes += len;
+		}
+
+		inline void http_analyzer::merge(const http_analyzer& other)
+		{
+			for (auto& i : other.hosts) hosts[i.first] += i.second;
+			for (auto& i : other.status_codes) status_codes[i.first] += i.second;
+
+			total_requests += other.total_requests;
+			total_responses += other.total_responses;
+
+			if (other.first_ts_usec != 0 && (first_ts_usec == 0 || other.first_ts_usec < first_ts_usec))
+				first_ts_usec = other.first_ts_usec;
+			last_ts_usec = std::max(last_ts_usec, other.last_ts_usec);
+		}
+
+		inline std::string http_analyzer::to_string() const
+		{
+			std::ostringstream ss;
+			const double seconds = last_ts_usec > first_ts_usec ? (last_ts_usec - first_ts_usec) / 1e6 : 0.0;
+
+			ss << "host\t" << "requests\t" << "req/s\t" << "responses\t" << "4xx\t" << "5xx\t" << "error ratio\t"
+				<< "request bytes\t" << "response bytes" << std::endl;
+
+			for (auto& i : hosts) {
+				const http_host_stats& h = i.second;
+				const double rate = seconds > 0 ? h.requests / seconds : 0.0;
+				const double errors = h.responses ? (double)(h.client_errors + h.server_errors) / h.responses : 0.0;
+
+				ss << (i.first.empty() ? "(unknown)" : i.first) << "\t"
+					<< h.requests << "\t" << std::fixed << std::setprecision(2) << rate << "\t"
+					<< h.responses << "\t" << h.client_errors << "\t" << h.server_errors << "\t"
+					<< std::setprecision(4) << errors << "\t"
+					<< h.request_bytes << "\t" << h.response_bytes << std::endl;
+			}
+			ss << std::endl;
+
+			ss << "status\t" << "count" << std::endl;
+			for (auto& i : status_codes)
+				ss << i.first << "\t" << i.second << std::endl;
+
+			return ss.str();
+		}
+
+		inline std::ostream& operator<<(std::ostream& os, const http_analyzer& h)
+		{
+			os << h.to_string();
+			return os;
+		}
+	}
+}
\ No newline at end of file
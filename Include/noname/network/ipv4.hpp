@@ -73,6 +73,8 @@ namespace noname_core {
 			std::string to_string() const;
 			PacketType get_next_packet_type() const;
 
+			static constexpr PacketType get_packet_type(uint8_t proto);
+
 			ip_header	operator+(const ip_header& i) const = delete;
 			ip_header	operator-(const ip_header& i) const = delete;
 			ip_header	operator*(const ip_header& i) const = delete;
@@ -86,25 +88,50 @@ namespace noname_core {
 		};
 #pragma pack(pop)
 
+		// Non-owning view over an IPv4 header in packet memory.
+		// Nothing is copied on construction; each getter decodes its field in host order on access.
+		struct ip_view final {
+			static constexpr std::size_t MIN_LEN = 20;
+
+			const uint8_t* data;
+
+			constexpr explicit ip_view(const uint8_t* data) : data(data) { }
+
+			constexpr uint8_t get_version() const { return data[0] >> 4; }
+			constexpr uint8_t get_header_length() const { return data[0] & 0x0F; }
+			constexpr uint16_t get_length() const { return load_be16(data + 2); }
+			constexpr uint16_t get_id() const { return load_be16(data + 4); }
+			constexpr uint8_t get_flag() const { return data[6] >> 5; }
+			constexpr uint16_t get_frag_offset() const { return load_be16(data + 6) & 0x1FFF; }
+			constexpr uint8_t get_ttl() const { return data[8]; }
+			constexpr uint8_t get_proto() const { return data[9]; }
+			constexpr uint16_t get_checksum() const { return load_be16(data + 10); }
+			constexpr uint32_t get_src_addr() const { return load_be32(data + 12); }
+			constexpr uint32_t get_des_addr() const { return load_be32(data + 16); }
+			ip_address get_src_ip() const { return ip_address(data + 12); }
+			ip_address get_des_ip() const { return ip_address(data + 16); }
+			constexpr PacketType get_next_packet_type() const { return ip_header::get_packet_type(get_proto()); }
+		};
+
 		inline ip_address::ip_address() : address{ 0 } { }
 
 		inline ip_address::ip_address(const uint8_t* data) : address{ 0 }
 		{
-			std::copy(address, address+3, data);
+			std::copy(data, data + LEN, address);
 		}
 
 		inline ip_address::ip_address(const ip_address& i) : address{ 0 }
 		{
-			std::copy(address, address+3, i.address);
+			std::copy(i.address, i.address + LEN, address);
 		}
 
 		inline std::string ip_address::to_string() const
 		{
 			std::ostringstream ss;
-			ss << static_cast<int>(address[3]) << "."
-				<< static_cast<int>(address[2]) << "."
+			ss << static_cast<int>(address[0]) << "."
 				<< static_cast<int>(address[1]) << "."
-				<< static_cast<int>(address[0]);
+				<< static_cast<int>(address[2]) << "."
+				<< static_cast<int>(address[3]);
 			return ss.str();
 		}
 
@@ -145,15 +172,9 @@ namespace noname_core {
 			, src_ip_addr(), des_ip_addr() { }
 
 		inline ip_header::ip_header(const uint8_t* data)
-			: header_length_and_version(data[0])
-			, ip_type_of_serivce(data[1])
-			, ip_length(data[2])
-			, ip_id(data[4])
-			, ip_flag_offset(data[6])
-			, ip_ttl(data[8])
-			, ip_proto(data[9])
-			, ip_check_sum(data[10])
-			, src_ip_addr(data + 12), des_ip_addr(data + 16) { }
+		{
+			memcpy(static_cast<void*>(this), data, sizeof *this);
+		}
 
 		inline ip_header::ip_header(const ip_header& i)
 			: header_length_and_version(i.header_length_and_version)
@@ -170,8 +191,8 @@ namespace noname_core {
 		inline uint8_t ip_header::get_header_length() const { return header_length_and_version & 0x0F; }
 		inline uint16_t ip_header::get_length() const { return bswap16(ip_length); }
 		inline uint16_t ip_header::get_id() const { return bswap16(ip_id); }
-		inline uint8_t ip_header::get_flag() const { return ip_flag_offset >> 13; }
-		inline uint16_t ip_header::get_frag_offset() const { return ip_flag_offset & 0x1FFF; }
+		inline uint8_t ip_header::get_flag() const { return bswap16(ip_flag_offset) >> 13; }
+		inline uint16_t ip_header::get_frag_offset() const { return bswap16(ip_flag_offset) & 0x1FFF; }
 		inline uint8_t ip_header::get_ttl() const { return ip_ttl; }
 		inline uint8_t ip_header::get_proto() const { return ip_proto; }
 		inline uint16_t ip_header::get_checksum() const { return bswap16(ip_check_sum); }
@@ -190,7 +211,12 @@ namespace noname_core {
 
 		inline PacketType ip_header::get_next_packet_type() const
 		{
-			switch (ip_proto)
+			return get_packet_type(ip_proto);
+		}
+
+		constexpr PacketType ip_header::get_packet_type(uint8_t proto)
+		{
+			switch (proto)
 			{
 			case IP_PROTO_TCP:
 				return PacketType::TCP;
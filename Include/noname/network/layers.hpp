@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ethernet.hpp"
+#include "ipv4.hpp"
+#include "tcp.hpp"
+#include "udp.hpp"
+
+namespace noname_core {
+	namespace network {
+		// Offsets of each decoded layer inside one captured frame.
+		// An offset of 0 means the layer is absent, truncated or malformed.
+		struct packet_layers {
+			PacketType	l3_type = PacketType::UNKNOWN;
+			PacketType	l4_type = PacketType::UNKNOWN;
+			uint16_t	l3_offset = 0;
+			uint16_t	l4_offset = 0;
+			uint16_t	payload_offset = 0;
+			uint32_t	payload_length = 0;
+
+			bool has_l3() const { return l3_offset != 0; }
+			bool has_l4() const { return l4_offset != 0; }
+			bool has_payload() const { return payload_offset != 0; }
+		};
+
+		// Walks ethernet -> IPv4 -> TCP/UDP using the real header lengths (IHL * 4, data offset * 4)
+		// and checks every layer against caplen. Header lengths are computed arithmetically, so
+		// packets with IP or TCP options take the same path as plain ones; the only branches are the
+		// bounds checks, which almost always go the same way.
+		// Returns false if the frame is too short to hold an ethernet header.
+		inline bool parse_layers(const uint8_t* data, std::size_t caplen, packet_layers& layers)
+		{
+			layers = packet_layers{};
+
+			if (NONAME_UNLIKELY(caplen < ethernet_view::LEN))
+				return false;
+
+			const ethernet_view ether(data);
+			if (ether.get_next_packet_type() != PacketType::IP)
+				return true;
+
+			const std::size_t l3 = ethernet_view::LEN;
+			if (NONAME_UNLIKELY(caplen < l3 + ip_view::MIN_LEN))
+				return true;
+
+			const ip_view ip(data + l3);
+			const std::size_t ip_len = ip.get_header_length() * 4u;
+			const std::size_t ip_total = ip.get_length();
+			if (NONAME_UNLIKELY(ip.get_version() != 4 || ip_len < ip_view::MIN_LEN || l3 + ip_len > caplen || ip_total < ip_len))
+				return true;
+
+			// the IP total length excludes ethernet padding; caplen may be shorter if the snaplen cut the frame
+			const std::size_t end = std::min(caplen, l3 + ip_total);
+
+			layers.l3_type = PacketType::IP;
+			layers.l3_offset = static_cast<uint16_t>(l3);
+
+			// only the first fragment carries the transport header
+			if (NONAME_UNLIKELY(ip.get_frag_offset() != 0))
+				return true;
+
+			const std::size_t l4 = l3 + ip_len;
+			const PacketType l4_type = ip.get_next_packet_type();
+
+			if (l4_type == PacketType::TCP) {
+				if (NONAME_UNLIKELY(end < l4 + tcp_view::MIN_LEN))
+					return true;
+
+				const std::size_t tcp_len = tcp_view(data + l4).get_header_length() * 4u;
+				if (NONAME_UNLIKELY(tcp_len < tcp_view::MIN_LEN || l4 + tcp_len > end))
+					return true;
+
+				layers.payload_offset = static_cast<uint16_t>(l4 + tcp_len);
+			}
+			else if (l4_type == PacketType::UDP) {
+				if (NONAME_UNLIKELY(end < l4 + udp_view::LEN))
+					return true;
+
+				layers.payload_offset = static_cast<uint16_t>(l4 + udp_view::LEN);
+			}
+			else {
+				return true;
+			}
+
+			layers.l4_type = l4_type;
+			layers.l4_offset = static_cast<uint16_t>(l4);
+			layers.payload_length = static_cast<uint32_t>(end - layers.payload_offset);
+			return true;
+		}
+	}
+}
\ No newline at end of file
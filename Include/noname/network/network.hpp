@@ -5,6 +5,8 @@
 #include "ethernet.hpp"
 #include "ipv4.hpp"
 #include "tcp.hpp"
+#include "udp.hpp"
+#include "layers.hpp"
 
 #include "header.hpp"
 #include "types.hpp"
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "batch_parser.hpp"
+
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+namespace noname_core {
+	namespace network {
+		// A batch of captured frames in structure-of-arrays form, exchanged whole between the
+		// reader, the parser and the aggregation stages. Frame bytes are copied into one
+		// contiguous buffer, so the batch stays valid after the capture buffer is reused.
+		struct packet_batch {
+			static constexpr std::size_t CAPACITY = MAX_BATCH_SIZE;
+			static constexpr std::size_t DEFAULT_BYTES_RESERVE = CAPACITY * 2048;
+
+			alignas(32) uint64_t ts_usec[CAPACITY];
+			alignas(32) uint32_t caplen[CAPACITY];
+			alignas(32) uint32_t wirelen[CAPACITY];
+			alignas(32) uint32_t link_offset[CAPACITY];	// start of the frame inside bytes
+			header_columns headers;						// filled by parse()
+
+			packet_batch() { bytes.reserve(DEFAULT_BYTES_RESERVE); }
+
+			std::size_t size() const { return count; }
+			bool empty() const { return count == 0; }
+			bool full() const { return count == CAPACITY; }
+
+			const uint8_t* get_data(std::size_t i) const { return bytes.data() + link_offset[i]; }
+
+			void push(uint64_t ts, uint32_t captured, uint32_t len, const uint8_t* data);
+			void parse();
+			void clear();
+
+		private:
+			std::vector<uint8_t> bytes;
+			std::size_t count = 0;
+		};
+
+		inline void packet_batch::push(uint64_t ts, uint32_t captured, uint32_t len, const uint8_t* data)
+		{
+			if (full())
+				throw std::length_error("packet_batch is full");
+
+			const std::size_t offset = bytes.size();
+			bytes.resize(offset + captured);
+			if (captured) std::memcpy(bytes.data() + offset, data, captured);
+
+			ts_usec[count] = ts;
+			caplen[count] = captured;
+			wirelen[count] = len;
+			link_offset[count] = static_cast<uint32_t>(offset);
+			count++;
+		}
+
+		inline void packet_batch::parse()
+		{
+			// frame pointers are only stable once the batch stops growing
+			const uint8_t* frames[CAPACITY];
+			for (std::size_t i = 0; i < count; ++i)
+				frames[i] = get_data(i);
+
+			parse_batch(frames, caplen, count, headers);
+		}
+
+		inline void packet_batch::clear()
+		{
+			bytes.clear();
+			count = 0;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NONAME_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#define NONAME_SCAN_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace noname_core {
+	namespace network {
+		inline unsigned count_trailing_zeros(uint32_t mask)
+		{
+#ifdef _MSC_VER
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return static_cast<unsigned>(index);
+#else
+			return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+		}
+
+		// Returns a pointer to the first occurrence of c in [begin, end), or end.
+		inline const uint8_t* find_byte(const uint8_t* begin, const uint8_t* end, uint8_t c)
+		{
+			const uint8_t* p = begin;
+
+#ifdef NONAME_SCAN_AVX2
+			const __m256i needle32 = _mm256_set1_epi8(static_cast<char>(c));
+			for (; end - p >= 32; p += 32) {
+				const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+				const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle32)));
+				if (mask)
+					return p + count_trailing_zeros(mask);
+			}
+#endif
+
+#ifdef NONAME_SCAN_SSE2
+			const __m128i needle16 = _mm_set1_epi8(static_cast<char>(c));
+			for (; end - p >= 16; p += 16) {
+				const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16)));
+				if (mask)
+					return p + count_trailing_zeros(mask);
+			}
+#endif
+
+			for (; p < end; ++p)
+				if (*p == c) return p;
+			return end;
+		}
+
+		// Returns a pointer to the first "\r\n" in [begin, end), or end.
+		inline const uint8_t* find_crlf(const uint8_t* begin, const uint8_t* end)
+		{
+			const uint8_t* p = begin;
+
+#ifdef NONAME_SCAN_SSE2
+			// compare the block and the block shifted by one so a CRLF is found in a single pass
+			const __m128i cr = _mm_set1_epi8('\r');
+			const __m128i lf = _mm_set1_epi8('\n');
+			for (; end - p >= 17; p += 16) {
+				const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+				const __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(first, cr), _mm_cmpeq_epi8(second, lf));
+				const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit));
+				if (mask)
+					return p + count_trailing_zeros(mask);
+			}
+#endif
+
+			while (p < end) {
+				p = find_byte(p, end, '\r');
+				if (p + 1 >= end)
+					return end;
+				if (p[1] == '\n')
+					return p;
+				++p;
+			}
+			return end;
+		}
+	}
+}
\ No newline at end of file
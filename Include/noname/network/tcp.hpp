@@ -8,6 +8,13 @@ namespace noname_core {
 	namespace network {
 #pragma pack(push, 1)
 		struct tcp_header final : public header<tcp_header> {
+			static constexpr auto TCP_PORT_HTTP = 80;
+			static constexpr auto TCP_PORT_HTTP_ALT = 8080;
+			static constexpr auto TCP_PORT_HTTPS = 443;
+
+			static constexpr uint8_t TCP_FLAG_FIN = 0x01;
+			static constexpr uint8_t TCP_FLAG_RST = 0x04;
+
 		private:
 			uint16_t src_port;
 			uint16_t des_port;
@@ -39,6 +46,9 @@ namespace noname_core {
 			//setter
 
 			std::string to_string() const;
+			PacketType get_next_packet_type() const;
+
+			static constexpr PacketType get_packet_type(uint16_t src_port, uint16_t des_port);
 
 			//operators
 			tcp_header operator+(const tcp_header& t) const = delete;
@@ -53,6 +63,28 @@ namespace noname_core {
 			friend std::ostream& operator<<(std::ostream& os, const tcp_header& t);
 		};
 #pragma pack(pop)
+
+		// Non-owning view over a TCP header in packet memory.
+		// Nothing is copied on construction; each getter decodes its field in host order on access.
+		struct tcp_view final {
+			static constexpr std::size_t MIN_LEN = 20;
+
+			const uint8_t* data;
+
+			constexpr explicit tcp_view(const uint8_t* data) : data(data) { }
+
+			constexpr uint16_t get_src_port() const { return load_be16(data); }
+			constexpr uint16_t get_des_port() const { return load_be16(data + 2); }
+			constexpr uint32_t get_seq_num() const { return load_be32(data + 4); }
+			constexpr uint32_t get_ack_num() const { return load_be32(data + 8); }
+			constexpr uint8_t get_header_length() const { return data[12] >> 4; }
+			constexpr uint8_t get_flags() const { return data[13] & 0x3F; }
+			constexpr uint16_t get_window_size() const { return load_be16(data + 14); }
+			constexpr uint16_t get_check_sum() const { return load_be16(data + 16); }
+			constexpr uint16_t get_urgent_prt() const { return load_be16(data + 18); }
+			constexpr PacketType get_next_packet_type() const { return tcp_header::get_packet_type(get_src_port(), get_des_port()); }
+		};
+
 		inline tcp_header::tcp_header()
 			: src_port(0)
 			, des_port(0)
@@ -64,14 +96,9 @@ namespace noname_core {
 			, urgent_ptr(0) { }
 
 		inline tcp_header::tcp_header(const uint8_t* data)
-			: src_port(data[0])
-			, des_port(data[2])
-			, seq_num(data[4])
-			, ack_num(data[8])
-			, header_len_flags(data[12])
-			, window_size(data[14])
-			, check_sum(data[16])
-			, urgent_ptr(data[18]) { }
+		{
+			memcpy(static_cast<void*>(this), data, sizeof *this);
+		}
 
 		inline tcp_header::tcp_header(const tcp_header& t)
 			: src_port(t.src_port)
@@ -87,9 +114,9 @@ namespace noname_core {
 		inline uint16_t tcp_header::get_des_port() const { return des_port; }
 		inline uint32_t tcp_header::get_seq_num() const { return seq_num; }
 		inline uint32_t tcp_header::get_ack_num() const { return ack_num; }
-		inline uint8_t tcp_header::get_header_length() const { return header_len_flags >> 12; }
-		inline uint8_t tcp_header::get_reserved() const { return (header_len_flags >> 6) & 0x3F; }
-		inline uint8_t tcp_header::get_flags() const { return header_len_flags & 0x3F; }
+		inline uint8_t tcp_header::get_header_length() const { return bswap16(header_len_flags) >> 12; }
+		inline uint8_t tcp_header::get_reserved() const { return (bswap16(header_len_flags) >> 6) & 0x3F; }
+		inline uint8_t tcp_header::get_flags() const { return bswap16(header_len_flags) & 0x3F; }
 		inline uint16_t tcp_header::get_window_size() const { return window_size; }
 		inline uint16_t tcp_header::get_check_sum() const { return check_sum; }
 		inline uint16_t tcp_header::get_urgent_prt() const { return urgent_ptr; }
@@ -103,6 +130,20 @@ namespace noname_core {
 			return ss.str();
 		}
 
+		inline PacketType tcp_header::get_next_packet_type() const
+		{
+			return get_packet_type(bswap16(src_port), bswap16(des_port));
+		}
+
+		constexpr PacketType tcp_header::get_packet_type(uint16_t src, uint16_t des)
+		{
+			if (src == TCP_PORT_HTTP || des == TCP_PORT_HTTP || src == TCP_PORT_HTTP_ALT || des == TCP_PORT_HTTP_ALT)
+				return PacketType::HTTP;
+			if (src == TCP_PORT_HTTPS || des == TCP_PORT_HTTPS)
+				return PacketType::TLS;
+			return PacketType::UNKNOWN;
+		}
+
 		inline tcp_header& tcp_header::operator=(const tcp_header& t)
 		{
 			src_port = t.src_port;
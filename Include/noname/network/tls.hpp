@@ -0,0 +1,423 @@
+#pragma once
+
+#include "header.hpp"
+#include "flow.hpp"
+#include "tcp.hpp"
+#include "../memory/string_table.hpp"
+
+#include <unordered_map>
+#include <string_view>
+
+namespace noname_core {
+	namespace network {
+		constexpr uint8_t TLS_CONTENT_HANDSHAKE = 0x16;
+		constexpr uint8_t TLS_HANDSHAKE_CLIENT_HELLO = 0x01;
+		constexpr uint16_t TLS_EXTENSION_SERVER_NAME = 0;
+		constexpr uint16_t TLS_EXTENSION_ALPN = 16;
+
+		constexpr std::size_t TLS_RECORD_HEADER_LEN = 5;
+		constexpr std::size_t TLS_HANDSHAKE_HEADER_LEN = 4;
+		constexpr std::size_t TLS_MAX_CLIENT_HELLO_LEN = 16 * 1024;
+
+		enum class TlsParseResult : int {
+			Complete,
+			NeedMore,
+			NotClientHello
+		};
+
+		struct tls_client_hello {
+			std::string_view server_name;
+			std::string_view alpn;	// protocols in offer order, comma separated
+			char alpn_buffer[256] = { 0 };
+		};
+
+		namespace {
+			inline uint16_t tls_read16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+			inline uint32_t tls_read24(const uint8_t* p) { return (p[0] << 16) | (p[1] << 8) | p[2]; }
+
+			inline bool tls_parse_extensions(const uint8_t* p, const uint8_t* end, tls_client_hello& hello)
+			{
+				if (end - p < 2) return true;	// ClientHello without extensions
+				const uint8_t* ext_end = p + 2 + tls_read16(p);
+				if (ext_end > end) return false;
+				p += 2;
+
+				while (ext_end - p >= 4) {
+					const uint16_t type = tls_read16(p);
+					const uint16_t len = tls_read16(p + 2);
+					const uint8_t* data = p + 4;
+					if (data + len > ext_end) return false;
+
+					if (type == TLS_EXTENSION_SERVER_NAME && len >= 5) {
+						const uint8_t* q = data + 2;
+						const uint8_t* list_end = std::min(data + 2 + tls_read16(data), data + len);
+						while (list_end - q >= 3) {
+							const uint8_t name_type = q[0];
+							const uint16_t name_len = tls_read16(q + 1);
+							if (q + 3 + name_len > list_end) return false;
+							if (name_type == 0) {
+								hello.server_name = std::string_view(reinterpret_cast<const char*>(q + 3), name_len);
+								break;
+							}
+							q += 3 + name_len;
+						}
+					}
+					else if (type == TLS_EXTENSION_ALPN && len >= 2) {
+						const uint8_t* q = data + 2;
+						const uint8_t* list_end = std::min(data + 2 + tls_read16(data), data + len);
+						std::size_t out = 0;
+						while (q < list_end) {
+							const uint8_t proto_len = q[0];
+							if (q + 1 + proto_len > list_end) return false;
+							if (out + proto_len + 1 >= sizeof hello.alpn_buffer) break;
+							if (out) hello.alpn_buffer[out++] = ',';
+							memcpy(hello.alpn_buffer + out, q + 1, proto_len);
+							out += proto_len;
+							q += 1 + proto_len;
+						}
+						hello.alpn = std::string_view(hello.alpn_buffer, out);
+					}
+					p = data + len;
+				}
+				return true;
+			}
+		}
+
+		// Extracts SNI and ALPN from a ClientHello at the start of the client byte stream.
+		// Returns NeedMore while the handshake message is still incomplete, so callers can
+		// accumulate segments and retry. Handshake messages fragmented over several records are joined.
+		inline TlsParseResult parse_tls_client_hello(const uint8_t* data, std::size_t len, tls_client_hello& hello, std::vector<uint8_t>& scratch)
+		{
+			if (len < 1) return TlsParseResult::NeedMore;
+			if (data[0] != TLS_CONTENT_HANDSHAKE) return TlsParseResult::NotClientHello;
+			if (len < TLS_RECORD_HEADER_LEN + TLS_HANDSHAKE_HEADER_LEN) return TlsParseResult::NeedMore;
+			if (data[1] != 0x03) return TlsParseResult::NotClientHello;
+
+			const uint8_t* record = data + TLS_RECORD_HEADER_LEN;
+			if (record[0] != TLS_HANDSHAKE_CLIENT_HELLO) return TlsParseResult::NotClientHello;
+
+			const std::size_t hello_len = tls_read24(record + 1);
+			if (hello_len > TLS_MAX_CLIENT_HELLO_LEN) return TlsParseResult::NotClientHello;
+
+			const uint8_t* body;
+			const std::size_t first_record_len = tls_read16(data + 3);
+
+			if (TLS_HANDSHAKE_HEADER_LEN + hello_len <= first_record_len) {
+				if (len < TLS_RECORD_HEADER_LEN + TLS_HANDSHAKE_HEADER_LEN + hello_len) return TlsParseResult::NeedMore;
+				body = record + TLS_HANDSHAKE_HEADER_LEN;
+			}
+			else {
+				// ClientHello larger than one record: join the fragments of consecutive handshake records
+				scratch.clear();
+				const uint8_t* p = data;
+				const uint8_t* end = data + len;
+				while (scratch.size() < TLS_HANDSHAKE_HEADER_LEN + hello_len) {
+					if (end - p < (std::ptrdiff_t)TLS_RECORD_HEADER_LEN) return TlsParseResult::NeedMore;
+					if (p[0] != TLS_CONTENT_HANDSHAKE) return TlsParseResult::NotClientHello;
+					const std::size_t record_len = tls_read16(p + 3);
+					if (end - p < (std::ptrdiff_t)(TLS_RECORD_HEADER_LEN + record_len)) return TlsParseResult::NeedMore;
+					scratch.insert(scratch.end(), p + TLS_RECORD_HEADER_LEN, p + TLS_RECORD_HEADER_LEN + record_len);
+					p += TLS_RECORD_HEADER_LEN + record_len;
+				}
+				body = scratch.data() + TLS_HANDSHAKE_HEADER_LEN;
+			}
+
+			const uint8_t* end = body + hello_len;
+			const uint8_t* p = body + 2 + 32;	// client_version, random
+			if (p + 1 > end) return TlsParseResult::NotClientHello;
+			p += 1 + p[0];						// session_id
+			if (p + 2 > end) return TlsParseResult::NotClientHello;
+			p += 2 + tls_read16(p);				// cipher_suites
+			if (p + 1 > end) return TlsParseResult::NotClientHello;
+			p += 1 + p[0];						// compression_methods
+			if (p > end) return TlsParseResult::NotClientHello;
+
+			if (!tls_parse_extensions(p, end, hello)) return TlsParseResult::NotClientHello;
+			return TlsParseResult::Complete;
+		}
+
+		struct tls_name_stats {
+			uint64_t flows = 0;
+			uint64_t packets = 0;
+			uint64_t bytes_to_server = 0;
+			uint64_t bytes_to_client = 0;
+		};
+
+		// Attributes TLS flow traffic to the SNI of the flow's ClientHello.
+		// Per-flow state is a single interned name id; only flows whose ClientHello is still
+		// incomplete keep a small in-order reassembly buffer. Flows are dropped after RST or a FIN in
+		// both directions, and flows idle for FLOW_TIMEOUT_USEC are swept; a flow still waiting for
+		// its hello at that point, or at finish(), is counted as "(no sni)".
+		class tls_analyzer {
+		public:
+			typedef memory::string_table::id_type name_id;
+
+			static constexpr uint64_t FLOW_TIMEOUT_USEC = 60000000;
+			static constexpr std::size_t FLOW_SWEEP_THRESHOLD = 65536;
+
+			tls_analyzer()
+			{
+				no_sni = names.intern("(no sni)");
+				no_alpn = names.intern("");
+			}
+
+			void process(const flow_key& flow, bool to_server, uint8_t tcp_flags, uint32_t seq, const uint8_t* payload, std::size_t len, std::size_t packet_bytes, uint64_t ts_usec);
+			// Counts the flows still waiting for a ClientHello and drops all per-flow state.
+			// Call it once the capture is done, before merge().
+			void finish();
+			void merge(const tls_analyzer& other);
+
+			std::string to_string() const;
+
+			friend std::ostream& operator<<(std::ostream& os, const tls_analyzer& t);
+
+		private:
+			struct known_flow {
+				name_id sni;
+				uint8_t fins = 0;	// 1: client FIN seen, 2: server FIN seen
+				uint64_t last_ts_usec = 0;
+			};
+
+			struct pending_flow {
+				bool has_seq = false;
+				uint32_t next_seq = 0;
+				uint8_t fins = 0;
+				uint64_t last_ts_usec = 0;
+				uint64_t packets = 0;
+				uint64_t bytes_to_server = 0;
+				uint64_t bytes_to_client = 0;
+				std::vector<uint8_t> data;
+			};
+
+			void process_payload(const flow_key& flow, pending_flow& pending, uint32_t seq, const uint8_t* payload, std::size_t len);
+			void resolve(const flow_key& flow, pending_flow& pending, name_id sni, name_id alpn);
+			void account(tls_name_stats& stats, bool to_server, std::size_t packet_bytes);
+			void account_unresolved(const pending_flow& pending);
+			void sweep_flows(uint64_t now_usec);
+
+			static bool is_closed(uint8_t& fins, bool to_server, uint8_t tcp_flags);
+
+			memory::string_table names;
+			name_id no_sni;
+			name_id no_alpn;
+
+			std::unordered_map<flow_key, known_flow> flows;
+			std::unordered_map<flow_key, pending_flow> pending_flows;
+			std::size_t next_sweep_size = FLOW_SWEEP_THRESHOLD;
+			std::unordered_map<name_id, tls_name_stats> by_name;
+			std::unordered_map<uint64_t, uint64_t> alpn_flows;
+			std::vector<uint8_t> scratch;
+		};
+
+		inline void tls_analyzer::account(tls_name_stats& stats, bool to_server, std::size_t packet_bytes)
+		{
+			stats.packets++;
+			if (to_server) stats.bytes_to_server += packet_bytes;
+			else stats.bytes_to_client += packet_bytes;
+		}
+
+		inline void tls_analyzer::resolve(const flow_key& flow, pending_flow& pending, name_id sni, name_id alpn)
+		{
+			tls_name_stats& stats = by_name[sni];
+			stats.flows++;
+			stats.packets += pending.packets;
+			stats.bytes_to_server += pending.bytes_to_server;
+			stats.bytes_to_client += pending.bytes_to_client;
+
+			alpn_flows[(static_cast<uint64_t>(sni) << 32) | alpn]++;
+			flows[flow] = known_flow{ sni, pending.fins, pending.last_ts_usec };
+			pending_flows.erase(flow);
+		}
+
+		// a flow that never sent client data is traffic of a flow that started before the capture
+		// (or a stray packet after close), so only its packets are counted
+		inline void tls_analyzer::account_unresolved(const pending_flow& pending)
+		{
+			tls_name_stats& stats = by_name[no_sni];
+			if (pending.has_seq) {
+				stats.flows++;
+				alpn_flows[(static_cast<uint64_t>(no_sni) << 32) | no_alpn]++;
+			}
+			stats.packets += pending.packets;
+			stats.bytes_to_server += pending.bytes_to_server;
+			stats.bytes_to_client += pending.bytes_to_client;
+		}
+
+		inline bool tls_analyzer::is_closed(uint8_t& fins, bool to_server, uint8_t tcp_flags)
+		{
+			if (tcp_flags & tcp_header::TCP_FLAG_FIN) fins |= to_server ? 1 : 2;
+			return (tcp_flags & tcp_header::TCP_FLAG_RST) || fins == 3;
+		}
+
+		inline void tls_analyzer::process(const flow_key& flow, bool to_server, uint8_t tcp_flags, uint32_t seq, const uint8_t* payload, std::size_t len, std::size_t packet_bytes, uint64_t ts_usec)
+		{
+			auto known = flows.find(flow);
+			if (known != flows.end()) {
+				account(by_name[known->second.sni], to_server, packet_bytes);
+				known->second.last_ts_usec = ts_usec;
+				if (is_closed(known->second.fins, to_server, tcp_flags))
+					flows.erase(known);
+				return;
+			}
+
+			auto it = pending_flows.find(flow);
+			if (it == pending_flows.end()) {
+				if (flows.size() + pending_flows.size() >= next_sweep_size)
+					sweep_flows(ts_usec);
+				it = pending_flows.emplace(flow, pending_flow{}).first;
+			}
+
+			pending_flow& pending = it->second;
+			pending.last_ts_usec = ts_usec;
+			pending.packets++;
+			if (to_server) pending.bytes_to_server += packet_bytes;
+			else pending.bytes_to_client += packet_bytes;
+
+			const bool closed = is_closed(pending.fins, to_server, tcp_flags);
+
+			// may resolve the flow, which moves it from pending_flows to flows
+			if (to_server && len != 0)
+				process_payload(flow, pending, seq, payload, len);
+
+			if (closed) {
+				auto resolved = flows.find(flow);
+				if (resolved != flows.end()) {
+					flows.erase(resolved);
+				}
+				else {
+					account_unresolved(pending);
+					pending_flows.erase(flow);
+				}
+			}
+		}
+
+		inline void tls_analyzer::process_payload(const flow_key& flow, pending_flow& pending, uint32_t seq, const uint8_t* payload, std::size_t len)
+		{
+			if (!pending.has_seq) {
+				pending.has_seq = true;
+				pending.next_seq = seq;
+			}
+
+			// in-order reassembly of the client stream; retransmitted bytes are skipped, a gap gives up
+			const int32_t delta = static_cast<int32_t>(seq - pending.next_seq);
+			if (delta > 0) {
+				resolve(flow, pending, no_sni, no_alpn);
+				return;
+			}
+			if (static_cast<std::size_t>(-delta) >= len) return;
+
+			payload += -delta;
+			len -= -delta;
+			pending.next_seq += static_cast<uint32_t>(len);
+
+			const uint8_t* data = payload;
+			std::size_t data_len = len;
+			if (!pending.data.empty()) {
+				pending.data.insert(pending.data.end(), payload, payload + len);
+				data = pending.data.data();
+				data_len = pending.data.size();
+			}
+
+			tls_client_hello hello;
+			switch (parse_tls_client_hello(data, data_len, hello, scratch))
+			{
+			case TlsParseResult::Complete:
+				resolve(flow, pending,
+					hello.server_name.empty() ? no_sni : names.intern(hello.server_name),
+					names.intern(hello.alpn));
+				break;
+			case TlsParseResult::NeedMore:
+				if (data_len > TLS_MAX_CLIENT_HELLO_LEN + 4 * TLS_RECORD_HEADER_LEN) {
+					resolve(flow, pending, no_sni, no_alpn);
+				}
+				else if (pending.data.empty()) {
+					pending.data.assign(payload, payload + len);
+				}
+				break;
+			default:
+				resolve(flow, pending, no_sni, no_alpn);
+				break;
+			}
+		}
+
+		inline void tls_analyzer::sweep_flows(uint64_t now_usec)
+		{
+			const auto idle = [now_usec](uint64_t last_ts_usec) { return now_usec > last_ts_usec && now_usec - last_ts_usec > FLOW_TIMEOUT_USEC; };
+
+			for (auto it = flows.begin(); it != flows.end();) {
+				if (idle(it->second.last_ts_usec)) it = flows.erase(it);
+				else ++it;
+			}
+			for (auto it = pending_flows.begin(); it != pending_flows.end();) {
+				if (idle(it->second.last_ts_usec)) {
+					account_unresolved(it->second);
+					it = pending_flows.erase(it);
+				}
+				else ++it;
+			}
+			next_sweep_size = std::max(FLOW_SWEEP_THRESHOLD, 2 * (flows.size() + pending_flows.size()));
+		}
+
+		inline void tls_analyzer::finish()
+		{
+			for (auto& i : pending_flows)
+				account_unresolved(i.second);
+
+			pending_flows.clear();
+			flows.clear();
+			next_sweep_size = FLOW_SWEEP_THRESHOLD;
+		}
+
+		inline void tls_analyzer::merge(const tls_analyzer& other)
+		{
+			for (auto& i : other.by_name) {
+				tls_name_stats& stats = by_name[names.intern(other.names.get(i.first))];
+				stats.flows += i.second.flows;
+				stats.packets += i.second.packets;
+				stats.bytes_to_server += i.second.bytes_to_server;
+				stats.bytes_to_client += i.second.bytes_to_client;
+			}
+
+			// nothing left once other.finish() ran
+			for (auto& i : other.pending_flows)
+				account_unresolved(i.second);
+
+			for (auto& i : other.alpn_flows) {
+				const name_id sni = names.intern(other.names.get(static_cast<name_id>(i.first >> 32)));
+				const name_id alpn = names.intern(other.names.get(static_cast<name_id>(i.first)));
+				alpn_flows[(static_cast<uint64_t>(sni) << 32) | alpn] += i.second;
+			}
+		}
+
+		inline std::string tls_analyzer::to_string() const
+		{
+			std::ostringstream ss;
+
+			std::vector<std::pair<name_id, tls_name_stats>> sorted(by_name.begin(), by_name.end());
+			std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) {
+				return a.second.bytes_to_server + a.second.bytes_to_client > b.second.bytes_to_server + b.second.bytes_to_client;
+			});
+
+			ss << "server name\t" << "flows\t" << "packets\t" << "client->server bytes\t" << "server->client bytes" << std::endl;
+			for (auto& i : sorted) {
+				ss << names.get(i.first) << "\t" << i.second.flows << "\t" << i.second.packets << "\t"
+					<< i.second.bytes_to_server << "\t" << i.second.bytes_to_client << std::endl;
+			}
+			ss << std::endl;
+
+			ss << "server name\t" << "alpn\t" << "flows" << std::endl;
+			for (auto& i : alpn_flows) {
+				const std::string_view alpn = names.get(static_cast<name_id>(i.first));
+				ss << names.get(static_cast<name_id>(i.first >> 32)) << "\t"
+					<< (alpn.empty() ? "-" : alpn) << "\t" << i.second << std::endl;
+			}
+			return ss.str();
+		}
+
+		inline std::ostream& operator<<(std::ostream& os, const tls_analyzer& t)
+		{
+			os << t.to_string();
+			return os;
+		}
+	}
+}
\ No newline at end of file
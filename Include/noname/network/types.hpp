@@ -10,6 +10,8 @@ namespace noname_core {
 			TCP,
 			UDP,
 			HTTP,
+			DNS,
+			TLS,
 			UNKNOWN
 		};
 	}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "header.hpp"
+#include "types.hpp"
+#include "utils.hpp"
+
+namespace noname_core {
+	namespace network {
+#pragma pack(push, 1)
+		struct udp_header final : public header<udp_header> {
+			static constexpr auto UDP_PORT_DNS = 53;
+
+		private:
+			uint16_t src_port;
+			uint16_t des_port;
+			uint16_t length;
+			uint16_t check_sum;
+
+		public:
+			udp_header();
+			udp_header(const uint8_t* data);
+			udp_header(const udp_header& u);
+
+			uint16_t get_src_port() const;
+			uint16_t get_des_port() const;
+			uint16_t get_length() const;
+			uint16_t get_check_sum() const;
+
+			std::string to_string() const;
+			PacketType get_next_packet_type() const;
+
+			static constexpr PacketType get_packet_type(uint16_t src_port, uint16_t des_port);
+
+			//operators
+			udp_header operator+(const udp_header& u) const = delete;
+			udp_header operator-(const udp_header& u) const = delete;
+			udp_header operator*(const udp_header& u) const = delete;
+			udp_header operator/(const udp_header& u) const = delete;
+			udp_header operator%(const udp_header& u) const = delete;
+			udp_header& operator=(const udp_header& u);
+			bool operator==(const udp_header& u) const;
+			bool operator!=(const udp_header& u) const;
+
+			friend std::ostream& operator<<(std::ostream& os, const udp_header& u);
+		};
+#pragma pack(pop)
+
+		// Non-owning view over a UDP header in packet memory.
+		// Nothing is copied on construction; each getter decodes its field in host order on access.
+		struct udp_view final {
+			static constexpr std::size_t LEN = 8;
+
+			const uint8_t* data;
+
+			constexpr explicit udp_view(const uint8_t* data) : data(data) { }
+
+			constexpr uint16_t get_src_port() const { return load_be16(data); }
+			constexpr uint16_t get_des_port() const { return load_be16(data + 2); }
+			constexpr uint16_t get_length() const { return load_be16(data + 4); }
+			constexpr uint16_t get_check_sum() const { return load_be16(data + 6); }
+			constexpr PacketType get_next_packet_type() const { return udp_header::get_packet_type(get_src_port(), get_des_port()); }
+		};
+
+		inline udp_header::udp_header()
+			: src_port(0)
+			, des_port(0)
+			, length(0)
+			, check_sum(0) { }
+
+		inline udp_header::udp_header(const uint8_t* data)
+		{
+			memcpy(static_cast<void*>(this), data, sizeof *this);
+		}
+
+		inline udp_header::udp_header(const udp_header& u)
+			: src_port(u.src_port)
+			, des_port(u.des_port)
+			, length(u.length)
+			, check_sum(u.check_sum) { }
+
+		inline uint16_t udp_header::get_src_port() const { return src_port; }
+		inline uint16_t udp_header::get_des_port() const { return des_port; }
+		inline uint16_t udp_header::get_length() const { return bswap16(length); }
+		inline uint16_t udp_header::get_check_sum() const { return check_sum; }
+
+		inline std::string udp_header::to_string() const
+		{
+			std::ostringstream ss;
+
+			ss << "src port: " << bswap16(src_port) << std::endl
+				<< "des port: " << bswap16(des_port) << std::endl;
+			return ss.str();
+		}
+
+		inline PacketType udp_header::get_next_packet_type() const
+		{
+			return get_packet_type(bswap16(src_port), bswap16(des_port));
+		}
+
+		constexpr PacketType udp_header::get_packet_type(uint16_t src, uint16_t des)
+		{
+			if (src == UDP_PORT_DNS || des == UDP_PORT_DNS)
+				return PacketType::DNS;
+			return PacketType::UNKNOWN;
+		}
+
+		inline udp_header& udp_header::operator=(const udp_header& u)
+		{
+			src_port = u.src_port;
+			des_port = u.des_port;
+			length = u.length;
+			check_sum = u.check_sum;
+			return *this;
+		}
+
+		inline bool udp_header::operator==(const udp_header& u) const
+		{
+			return src_port == u.src_port
+				&& des_port == u.des_port
+				&& length == u.length
+				&& check_sum == u.check_sum;
+		}
+
+		inline bool udp_header::operator!=(const udp_header& u) const
+		{
+			return !(*this == u);
+		}
+
+		inline std::ostream& operator<<(std::ostream& os, const udp_header& u)
+		{
+			os << u.to_string();
+			return os;
+		}
+	}
+}
\ No newline at end of file
@@ -2,21 +2,29 @@
 
 #include "header.hpp"
 
+#if defined(__GNUC__) || defined(__clang__)
+#define NONAME_LIKELY(x) __builtin_expect(!!(x), 1)
+#define NONAME_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define NONAME_LIKELY(x) (x)
+#define NONAME_UNLIKELY(x) (x)
+#endif
+
 namespace noname_core {
 	namespace network {
-		inline uint16_t bswap16(uint16_t value)
+		constexpr uint16_t bswap16(uint16_t value)
 		{
 			return ((uint16_t)((((value) >> 8) & 0xff)
 				| (((value) & 0xff) << 8)));
 		}
 
-		inline uint32_t bswap32(uint32_t value)
+		constexpr uint32_t bswap32(uint32_t value)
 		{
 			return ((((value) & 0xff000000u) >> 24) | (((value) & 0x00ff0000u) >> 8)
 				| (((value) & 0x0000ff00u) << 8) | (((value) & 0x000000ffu) << 24));
 		}
 
-		inline uint64_t bswap64(uint64_t value)
+		constexpr uint64_t bswap64(uint64_t value)
 		{
 			return ((((value) & 0xff00000000000000ull) >> 56)
 				| (((value) & 0x00ff000000000000ull) >> 40)
@@ -27,5 +35,18 @@ namespace noname_core {
 				| (((value) & 0x000000000000ff00ull) << 40)
 				| (((value) & 0x00000000000000ffull) << 56));
 		}
+
+		// Big-endian loads from unaligned packet memory. Compilers fold the byte assembly into
+		// a single load + bswap (movbe), and the functions stay usable in constant expressions.
+		constexpr uint16_t load_be16(const uint8_t* p)
+		{
+			return static_cast<uint16_t>((p[0] << 8) | p[1]);
+		}
+
+		constexpr uint32_t load_be32(const uint8_t* p)
+		{
+			return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+				| (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace noname_core {
+	namespace perf {
+		struct hw_counter_values {
+			uint64_t cycles = 0;
+			uint64_t instructions = 0;
+			uint64_t llc_misses = 0;
+			uint64_t branch_misses = 0;
+			bool valid = false;
+
+			hw_counter_values& operator+=(const hw_counter_values& v);
+		};
+
+		inline hw_counter_values& hw_counter_values::operator+=(const hw_counter_values& v)
+		{
+			if (!v.valid) return *this;
+			cycles += v.cycles;
+			instructions += v.instructions;
+			llc_misses += v.llc_misses;
+			branch_misses += v.branch_misses;
+			valid = true;
+			return *this;
+		}
+
+		// One perf_event_open group (cycles, instructions, LLC misses, branch misses) counting user space
+		// of the thread that called open(). start()/stop() can bracket a code path many times; read()
+		// returns the totals, scaled up if the kernel had to multiplex the group.
+		// On other platforms, or when the kernel refuses (perf_event_paranoid), open() returns false.
+		class hw_counter_group {
+		public:
+			static constexpr int NUM_EVENTS = 4;
+
+			hw_counter_group() = default;
+			~hw_counter_group() { close(); }
+
+			hw_counter_group(const hw_counter_group&) = delete;
+			hw_counter_group& operator=(const hw_counter_group&) = delete;
+
+			bool open();
+			void close();
+			bool is_open() const { return fds[0] != -1; }
+
+			void start();
+			void stop();
+			hw_counter_values read() const;
+
+			const std::string& get_error() const { return error; }
+
+		private:
+			int fds[NUM_EVENTS] = { -1, -1, -1, -1 };
+			std::string error;
+		};
+
+#ifdef __linux__
+		inline bool hw_counter_group::open()
+		{
+			static constexpr uint64_t configs[NUM_EVENTS] = {
+				PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_CACHE_MISSES,
+				PERF_COUNT_HW_BRANCH_MISSES,
+			};
+
+			close();
+			for (int i = 0; i < NUM_EVENTS; ++i) {
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof attr);
+				attr.size = sizeof attr;
+				attr.type = PERF_TYPE_HARDWARE;
+				attr.config = configs[i];
+				attr.disabled = i == 0;		// members follow the leader
+				attr.exclude_kernel = 1;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+				fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0));
+				if (fds[i] == -1) {
+					error = std::string("perf_event_open: ") + std::strerror(errno);
+					close();
+					return false;
+				}
+			}
+			return true;
+		}
+
+		inline void hw_counter_group::close()
+		{
+			for (int i = NUM_EVENTS - 1; i >= 0; --i) {
+				if (fds[i] != -1) ::close(fds[i]);
+				fds[i] = -1;
+			}
+		}
+
+		inline void hw_counter_group::start()
+		{
+			if (is_open()) ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+		inline void hw_counter_group::stop()
+		{
+			if (is_open()) ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+
+		inline hw_counter_values hw_counter_group::read() const
+		{
+			hw_counter_values v;
+			if (!is_open()) return v;
+
+			struct {
+				uint64_t nr;
+				uint64_t time_enabled;
+				uint64_t time_running;
+				uint64_t values[NUM_EVENTS];
+			} data;
+
+			if (::read(fds[0], &data, sizeof data) != static_cast<ssize_t>(sizeof data) || data.nr != NUM_EVENTS)
+				return v;
+
+			const double scale = data.time_running ? static_cast<double>(data.time_enabled) / data.time_running : 0.0;
+			v.cycles = static_cast<uint64_t>(data.values[0] * scale);
+			v.instructions = static_cast<uint64_t>(data.values[1] * scale);
+			v.llc_misses = static_cast<uint64_t>(data.values[2] * scale);
+			v.branch_misses = static_cast<uint64_t>(data.values[3] * scale);
+			v.valid = true;
+			return v;
+		}
+#else
+		inline bool hw_counter_group::open()
+		{
+			error = "hardware counters need perf_event_open (Linux)";
+			return false;
+		}
+
+		inline void hw_counter_group::close() { }
+		inline void hw_counter_group::start() { }
+		inline void hw_counter_group::stop() { }
+		inline hw_counter_values hw_counter_group::read() const { return {}; }
+#endif
+
+		// Starts a group for the lifetime of the scope; a null or closed group is ignored.
+		class hw_counter_scope {
+		public:
+			explicit hw_counter_scope(hw_counter_group* group) : group(group) { if (group) group->start(); }
+			~hw_counter_scope() { if (group) group->stop(); }
+
+			hw_counter_scope(const hw_counter_scope&) = delete;
+			hw_counter_scope& operator=(const hw_counter_scope&) = delete;
+
+		private:
+			hw_counter_group* group;
+		};
+	}
+}
\ No newline at end of file
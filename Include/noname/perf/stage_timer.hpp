@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <ostream>
+
+#include "hw_counters.hpp"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <ctime>
+#endif
+
+namespace noname_core {
+	namespace perf {
+		inline uint64_t now_nsec()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// CPU time of every thread in the process, user + system.
+		inline double process_cpu_seconds()
+		{
+#ifdef _WIN32
+			FILETIME creation, exit, kernel, user;
+			if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+				return 0.0;
+
+			const auto to_100ns = [](const FILETIME& t) { return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+			return (to_100ns(kernel) + to_100ns(user)) / 1e7;
+#else
+			timespec ts;
+			if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+				return 0.0;
+			return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+		}
+
+		// Time accounting of one pipeline stage (one thread).
+		// idle: waiting for input (an empty channel); blocked: waiting for the next stage (a full channel).
+		// Whatever is left of the stage's wall time is busy.
+		struct stage_stats {
+			std::string name;
+			uint64_t wall_nsec = 0;
+			uint64_t idle_nsec = 0;
+			uint64_t blocked_nsec = 0;
+			uint64_t packets = 0;
+			uint64_t bytes = 0;
+
+			uint64_t get_busy_nsec() const
+			{
+				const uint64_t waiting = idle_nsec + blocked_nsec;
+				return wall_nsec > waiting ? wall_nsec - waiting : 0;
+			}
+		};
+
+		// Fills a stage_stats; a timer without stats is disabled and costs one branch per call.
+		class stage_timer {
+		public:
+			explicit stage_timer(stage_stats* stats = nullptr) : stats(stats) { }
+
+			bool enabled() const { return stats != nullptr; }
+
+			void start() { if (stats) start_nsec = now_nsec(); }
+			void stop() { if (stats) stats->wall_nsec += now_nsec() - start_nsec; }
+
+			void count(uint64_t packets, uint64_t bytes)
+			{
+				if (!stats) return;
+				stats->packets += packets;
+				stats->bytes += bytes;
+			}
+
+			template <typename Fn>
+			void idle(Fn&& fn) { measure(fn, &stage_stats::idle_nsec); }
+
+			template <typename Fn>
+			void blocked(Fn&& fn) { measure(fn, &stage_stats::blocked_nsec); }
+
+		private:
+			template <typename Fn>
+			void measure(Fn& fn, uint64_t stage_stats::* field)
+			{
+				if (!stats) {
+					fn();
+					return;
+				}
+				const uint64_t begin = now_nsec();
+				fn();
+				stats->*field += now_nsec() - begin;
+			}
+
+			stage_stats* stats;
+			uint64_t start_nsec = 0;
+		};
+
+		// Whole-run summary: throughput over wall and CPU time plus the per-stage breakdown.
+		class perf_report {
+		public:
+			void set_totals(double wall_seconds, double cpu_seconds, uint64_t packets, uint64_t bytes)
+			{
+				this->wall_seconds = wall_seconds;
+				this->cpu_seconds = cpu_seconds;
+				this->packets = packets;
+				this->bytes = bytes;
+			}
+
+			void add_stage(const stage_stats& stage) { stages.push_back(stage); }
+
+			// hardware counters of a code path, reported per packet that went through it
+			void add_counters(const std::string& name, const hw_counter_values& values, uint64_t packets)
+			{
+				if (values.valid) counters.push_back({ name, values, packets });
+			}
+
+			std::string to_string() const;
+
+			friend std::ostream& operator<<(std::ostream& os, const perf_report& r);
+
+		private:
+			double wall_seconds = 0.0;
+			double cpu_seconds = 0.0;
+			uint64_t packets = 0;
+			uint64_t bytes = 0;
+			std::vector<stage_stats> stages;
+
+			struct counter_row {
+				std::string name;
+				hw_counter_values values;
+				uint64_t packets;
+			};
+			std::vector<counter_row> counters;
+		};
+
+		inline std::string perf_report::to_string() const
+		{
+			std::ostringstream ss;
+			const double pps = wall_seconds > 0 ? packets / wall_seconds : 0.0;
+			const double bps = wall_seconds > 0 ? bytes / wall_seconds : 0.0;
+
+			ss << std::fixed << std::setprecision(3)
+				<< "wall time: " << wall_seconds << " s\tcpu time: " << cpu_seconds << " s"
+				<< "\tcpu utilization: " << std::setprecision(2) << (wall_seconds > 0 ? cpu_seconds / wall_seconds : 0.0) << std::endl
+				<< "packets: " << packets << "\tbytes: " << bytes << std::endl
+				<< std::setprecision(1) << "packets/s: " << pps << "\tMB/s: " << bps / 1e6
+				<< "\tGbit/s: " << std::setprecision(3) << bps * 8 / 1e9 << std::endl << std::endl;
+
+			ss << "stage\t" << "wall ms\t" << "busy %\t" << "idle %\t" << "blocked %\t" << "packets\t" << "bytes" << std::endl;
+			for (auto& s : stages) {
+				const double wall = s.wall_nsec ? static_cast<double>(s.wall_nsec) : 1.0;
+				ss << s.name << "\t" << std::setprecision(1) << s.wall_nsec / 1e6 << "\t"
+					<< 100.0 * s.get_busy_nsec() / wall << "\t"
+					<< 100.0 * s.idle_nsec / wall << "\t"
+					<< 100.0 * s.blocked_nsec / wall << "\t"
+					<< s.packets << "\t" << s.bytes << std::endl;
+			}
+
+			if (!counters.empty()) {
+				ss << std::endl << "path\t" << "cycles/pkt\t" << "instructions/pkt\t" << "IPC\t" << "LLC misses/pkt\t" << "branch misses/pkt" << std::endl;
+				for (auto& c : counters) {
+					const double n = c.packets ? static_cast<double>(c.packets) : 1.0;
+					ss << c.name << "\t" << std::setprecision(1) << c.values.cycles / n << "\t" << c.values.instructions / n << "\t"
+						<< std::setprecision(2) << (c.values.cycles ? (double)c.values.instructions / c.values.cycles : 0.0) << "\t"
+						<< std::setprecision(3) << c.values.llc_misses / n << "\t" << c.values.branch_misses / n << std::endl;
+				}
+			}
+			return ss.str();
+		}
+
+		inline std::ostream& operator<<(std::ostream& os, const perf_report& r)
+		{
+			os << r.to_string();
+			return os;
+		}
+	}
+}
\ No newline at end of file
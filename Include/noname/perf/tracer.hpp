@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+
+namespace noname_core {
+	namespace perf {
+		namespace {
+			constexpr std::size_t DEFAULT_TRACE_EVENTS_PER_THREAD = 1 << 20;
+		}
+
+		struct trace_event {
+			const char* name;	// must outlive the tracer, in practice a string literal
+			uint64_t begin_nsec;
+			uint64_t end_nsec;
+		};
+
+		// Timeline recorder that writes Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+		// Every thread appends to its own fixed-size buffer, so recording takes no lock; a thread
+		// registers its buffer once, on its first event. When the tracer is disabled each call site
+		// costs one relaxed atomic load. enable() must run before the traced threads start and write()
+		// after they are done.
+		class tracer {
+		public:
+			static tracer& instance()
+			{
+				static tracer t;
+				return t;
+			}
+
+			void enable(std::size_t events_per_thread = DEFAULT_TRACE_EVENTS_PER_THREAD)
+			{
+				capacity = events_per_thread;
+				origin_nsec = clock_nsec();
+				enabled.store(true, std::memory_order_release);
+			}
+
+			void disable() { enabled.store(false, std::memory_order_release); }
+
+			bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+			static uint64_t clock_nsec()
+			{
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count();
+			}
+
+			// records a span that has already finished
+			void complete(const char* name, uint64_t begin_nsec, uint64_t end_nsec)
+			{
+				if (!is_enabled()) return;
+
+				thread_events& events = local_events();
+				if (events.events.size() == events.events.capacity()) {
+					events.dropped++;
+					return;
+				}
+				events.events.push_back(trace_event{ name, begin_nsec, end_nsec });
+			}
+
+			void set_thread_name(const std::string& name)
+			{
+				if (is_enabled()) local_events().name = name;
+			}
+
+			bool write(const std::string& path) const;
+
+		private:
+			struct thread_events {
+				uint32_t tid;
+				std::string name;
+				std::vector<trace_event> events;
+				uint64_t dropped = 0;
+			};
+
+			tracer() = default;
+
+			thread_events& local_events()
+			{
+				static thread_local thread_events* local = nullptr;
+				if (!local) {
+					std::lock_guard<std::mutex> lock(threads_lock);
+					threads.emplace_back(new thread_events());
+					local = threads.back().get();
+					local->tid = static_cast<uint32_t>(threads.size());
+					local->events.reserve(capacity);
+				}
+				return *local;
+			}
+
+			std::atomic<bool> enabled{ false };
+			std::size_t capacity = DEFAULT_TRACE_EVENTS_PER_THREAD;
+			uint64_t origin_nsec = 0;
+
+			mutable std::mutex threads_lock;
+			std::vector<std::unique_ptr<thread_events>> threads;
+		};
+
+		inline bool tracer::write(const std::string& path) const
+		{
+			std::ofstream out(path);
+			if (!out) return false;
+
+			std::lock_guard<std::mutex> lock(threads_lock);
+			const auto usec = [&](uint64_t nsec) { return nsec > origin_nsec ? (nsec - origin_nsec) / 1e3 : 0.0; };
+
+			out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::endl << std::fixed << std::setprecision(3);
+			bool first = true;
+
+			for (auto& t : threads) {
+				const std::string name = t->name.empty() ? "thread " + std::to_string(t->tid) : t->name;
+				out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t->tid
+					<< ", \"args\": {\"name\": \"" << name << "\"}}";
+				first = false;
+
+				for (auto& e : t->events) {
+					out << ",\n{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t->tid
+						<< ", \"ts\": " << usec(e.begin_nsec) << ", \"dur\": " << (e.end_nsec - e.begin_nsec) / 1e3 << "}";
+				}
+
+				if (t->dropped) {
+					out << ",\n{\"name\": \"dropped " << t->dropped << " events\", \"ph\": \"i\", \"s\": \"t\", \"pid\": 1, \"tid\": " << t->tid
+						<< ", \"ts\": " << (t->events.empty() ? 0.0 : usec(t->events.back().end_nsec)) << "}";
+				}
+			}
+			out << std::endl << "]}" << std::endl;
+			return static_cast<bool>(out);
+		}
+
+		// Records the enclosing scope as one span when the tracer is enabled.
+		class trace_scope {
+		public:
+			explicit trace_scope(const char* name)
+				: name(name)
+				, begin_nsec(tracer::instance().is_enabled() ? tracer::clock_nsec() : 0) { }
+
+			~trace_scope()
+			{
+				if (begin_nsec) tracer::instance().complete(name, begin_nsec, tracer::clock_nsec());
+			}
+
+			trace_scope(const trace_scope&) = delete;
+			trace_scope& operator=(const trace_scope&) = delete;
+
+		private:
+			const char* name;
+			uint64_t begin_nsec;
+		};
+	}
+}
\ No newline at end of file
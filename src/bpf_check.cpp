@@ -0,0 +1,473 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <stdexcept>
+
+#include <pcap.h>
+
+#include "noname/filter/bpf_evaluator.hpp"
+
+// Differential test of filter::bpf_evaluator against libpcap's bpf_filter().
+// Runs pcap_compile'd filter expressions, hand-written programs for the corner cases (ALU with X,
+// IND/MSH loads, JSET, division by zero, shifts >= 32, out-of-bounds loads) and random programs
+// over crafted and random packets, and compares the returned snap lengths.
+// A program libpcap rejects must be rejected by the evaluator; the evaluator may reject more
+// (pcap_stats then falls back to pcap_offline_filter), which is only counted.
+// usage: bpf_check [--programs N] [--seed S]
+
+namespace {
+	struct packet {
+		std::vector<uint8_t> data;
+		uint32_t wirelen;
+	};
+
+	struct check_stats {
+		uint64_t programs = 0;
+		uint64_t runs = 0;
+		uint64_t rejected = 0;			// by both
+		uint64_t evaluator_only = 0;	// rejected by the evaluator only
+	};
+
+	void put16(std::vector<uint8_t>& f, std::size_t at, uint16_t v)
+	{
+		f[at] = static_cast<uint8_t>(v >> 8);
+		f[at + 1] = static_cast<uint8_t>(v);
+	}
+
+	std::vector<uint8_t> make_frame(std::mt19937& rng, uint16_t ether_type, uint8_t proto, std::size_t ip_len, std::size_t payload)
+	{
+		const bool tcp = proto == 6;
+		const std::size_t l4 = tcp ? 20 : 8;
+		std::vector<uint8_t> f(14 + ip_len + l4 + payload);
+		for (auto& b : f) b = static_cast<uint8_t>(rng());
+
+		put16(f, 12, ether_type);
+		if (ether_type == 0x86DD) {
+			f[14] = 0x60;
+			f[20] = proto;
+			return f;
+		}
+		if (ether_type != 0x0800)
+			return f;
+
+		f[14] = static_cast<uint8_t>(0x40 | (ip_len / 4));
+		put16(f, 16, static_cast<uint16_t>(ip_len + l4 + payload));
+		put16(f, 20, rng() % 8 ? 0x4000 : static_cast<uint16_t>(rng() & 0x3FFF));
+		f[23] = proto;
+		if (rng() % 2) {
+			f[26] = 10; f[27] = 0; f[28] = 0; f[29] = 1;
+		}
+		if (tcp) {
+			put16(f, 14 + ip_len, rng() % 2 ? 80 : static_cast<uint16_t>(rng()));
+			put16(f, 14 + ip_len + 2, rng() % 2 ? 443 : static_cast<uint16_t>(rng()));
+			f[14 + ip_len + 12] = 0x50;
+		}
+		else if (proto == 17) {
+			put16(f, 14 + ip_len + 2, rng() % 2 ? 53 : static_cast<uint16_t>(rng()));
+		}
+		return f;
+	}
+
+	std::vector<packet> make_packets(std::mt19937& rng)
+	{
+		std::vector<packet> packets;
+
+		const auto add = [&](std::vector<uint8_t> f, bool truncate) {
+			const uint32_t wirelen = static_cast<uint32_t>(f.size() + (rng() % 4 == 0 ? rng() % 64 : 0));
+			if (truncate) f.resize(rng() % (f.size() + 1));
+			packets.push_back({ std::move(f), wirelen });
+		};
+
+		for (int i = 0; i < 96; ++i) {
+			const int kind = i % 8;
+			const std::size_t ip_len = rng() % 4 ? 20 : 20 + 4 * (rng() % 11);
+			const std::size_t payload = rng() % 3 ? rng() % 64 : rng() % 1400;
+			const bool truncate = rng() % 4 == 0;
+
+			switch (kind) {
+			case 0: case 1: add(make_frame(rng, 0x0800, 6, ip_len, payload), truncate); break;
+			case 2: add(make_frame(rng, 0x0800, 17, ip_len, payload), truncate); break;
+			case 3: add(make_frame(rng, 0x0800, 1, ip_len, payload), truncate); break;
+			case 4: add(make_frame(rng, 0x86DD, rng() % 2 ? 6 : 17, 40, payload), truncate); break;
+			case 5: {
+				std::vector<uint8_t> f = make_frame(rng, 0x8100, 6, ip_len, payload + 4);
+				put16(f, 16, 0x0800);
+				add(std::move(f), truncate);
+				break;
+			}
+			case 6: add(make_frame(rng, 0x0806, 0, 0, 28), truncate); break;
+			default: {
+				std::vector<uint8_t> f(rng() % 128);
+				for (auto& b : f) b = static_cast<uint8_t>(rng());
+				add(std::move(f), false);
+				break;
+			}
+			}
+		}
+
+		std::vector<uint8_t> broadcast = make_frame(rng, 0x0800, 17, 20, 16);
+		std::fill(broadcast.begin(), broadcast.begin() + 6, 0xFF);
+		add(std::move(broadcast), false);
+		add({}, false);
+		return packets;
+	}
+
+	void dump(const char* what, const std::vector<bpf_insn>& code)
+	{
+		std::cerr << what << " (" << code.size() << " instructions, as tcpdump -dd):" << std::endl << std::hex;
+		for (auto& i : code) {
+			std::cerr << "{ 0x" << std::setw(2) << std::setfill('0') << i.code << ", " << std::dec << int(i.jt) << ", " << int(i.jf)
+				<< ", 0x" << std::hex << std::setw(8) << std::setfill('0') << i.k << " }," << std::endl;
+		}
+		std::cerr << std::dec;
+	}
+
+	bool check(const char* what, const std::vector<bpf_insn>& code, const std::vector<packet>& packets, check_stats& stats)
+	{
+		struct bpf_program program;
+		program.bf_len = static_cast<u_int>(code.size());
+		program.bf_insns = const_cast<bpf_insn*>(code.data());
+		stats.programs++;
+
+		const bool valid = bpf_validate(program.bf_insns, static_cast<int>(program.bf_len)) != 0;
+
+		noname_core::filter::bpf_evaluator evaluator;
+		try {
+			evaluator = noname_core::filter::bpf_evaluator(program);
+		}
+		catch (const std::invalid_argument&) {
+			if (valid) stats.evaluator_only++;
+			else stats.rejected++;
+			return true;
+		}
+
+		if (!valid) {
+			dump(what, code);
+			std::cerr << "accepted by the evaluator but rejected by bpf_validate" << std::endl;
+			return false;
+		}
+
+		for (auto& p : packets) {
+			static const uint8_t empty = 0;
+			const uint8_t* data = p.data.empty() ? &empty : p.data.data();
+			const uint32_t caplen = static_cast<uint32_t>(p.data.size());
+
+			const u_int expected = bpf_filter(program.bf_insns, data, p.wirelen, caplen);
+			const uint32_t actual = evaluator.run(data, p.wirelen, caplen);
+			stats.runs++;
+
+			if (expected != actual) {
+				dump(what, code);
+				std::cerr << "caplen " << caplen << " wirelen " << p.wirelen << ": bpf_filter returned " << expected
+					<< ", the evaluator " << actual << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool check_expressions(const std::vector<packet>& packets, check_stats& stats)
+	{
+		static const char* expressions[] = {
+			"", "ip", "ip6", "arp", "tcp", "udp", "icmp", "vlan", "vlan and tcp",
+			"tcp port 80", "port 53", "tcp portrange 1000-2000", "not port 22",
+			"host 10.0.0.1", "src host 10.0.0.1 and dst port 443", "net 10.0.0.0/8", "ip proto 47",
+			"ether broadcast", "ether multicast", "ip multicast", "ether[0] & 1 = 1",
+			"ip6 and tcp port 80", "ip6 and udp", "udp port 53 or tcp port 443",
+			"tcp[tcpflags] & (tcp-syn|tcp-fin) != 0", "tcp[13] & 2 != 0", "tcp[tcpflags] = tcp-ack",
+			"ip[6:2] & 0x1fff = 0", "ip[0] & 0xf > 5", "len > 100", "greater 64", "less 60",
+			"ip[2:2] - 20 > 40", "ip[2:2] * 3 > 100", "ip[2:2] % 7 = 3", "ip[2:2] / 4 = 10",
+			"ip[2:2] << 2 > 4000", "ip[2:2] >> 3 = 10", "ip[2:2] & 0xff ^ 0x0f = 1", "-ip[8] < 10",
+			"tcp[0:2] / tcp[4] > 1", "tcp[0:2] % tcp[4] = 1", "ip[0] << ip[1] = 64", "ip[2:2] >> ip[8] = 0",
+			"tcp[(tcp[12] >> 4) * 4] = 0x47", "udp[8:4] = 0x12345678", "ether[len - 1] = 0",
+			"ip and (tcp[20:4] = 0x47455420 or tcp[20:4] = 0x504f5354)",
+		};
+
+		pcap_t* handle = pcap_open_dead(DLT_EN10MB, 262144);
+		if (!handle) {
+			std::cerr << "pcap_open_dead failed" << std::endl;
+			return false;
+		}
+
+		bool ok = true;
+		for (const char* expression : expressions) {
+			for (int optimize : { 1, 0 }) {
+				struct bpf_program program;
+				if (pcap_compile(handle, &program, expression, optimize, PCAP_NETMASK_UNKNOWN) == -1) {
+					std::cerr << "cannot compile \"" << expression << "\": " << pcap_geterr(handle) << std::endl;
+					ok = false;
+					continue;
+				}
+
+				const std::vector<bpf_insn> code(program.bf_insns, program.bf_insns + program.bf_len);
+				pcap_freecode(&program);
+
+				const std::string what = "\"" + std::string(expression) + "\"" + (optimize ? "" : " unoptimized");
+				if (!check(what.c_str(), code, packets, stats)) {
+					ok = false;
+					break;
+				}
+			}
+		}
+		pcap_close(handle);
+		return ok;
+	}
+
+	bool check_crafted(const std::vector<packet>& packets, check_stats& stats)
+	{
+		std::vector<std::vector<bpf_insn>> programs;
+
+		// ALU with X, including division by a zero X and shifts by 32 and more
+		for (uint16_t op : { BPF_ADD, BPF_SUB, BPF_MUL, BPF_DIV, BPF_MOD, BPF_AND, BPF_OR, BPF_XOR, BPF_LSH, BPF_RSH }) {
+			for (uint32_t x : { 0u, 1u, 3u, 31u, 32u, 33u, 0xFFFFFFFFu }) {
+				programs.push_back({
+					BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 26),
+					BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, x),
+					BPF_STMT(BPF_ALU | op | BPF_X, 0),
+					BPF_STMT(BPF_RET | BPF_A, 0),
+				});
+			}
+			programs.push_back({
+				BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+				BPF_STMT(BPF_MISC | BPF_TAX, 0),
+				BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 16),
+				BPF_STMT(BPF_ALU | op | BPF_X, 0),
+				BPF_STMT(BPF_RET | BPF_A, 0),
+			});
+			programs.push_back({
+				BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 16),
+				BPF_STMT(BPF_ALU | op | BPF_K, 7),
+				BPF_STMT(BPF_RET | BPF_A, 0),
+			});
+		}
+
+		// division by a zero constant and constant shifts of 32 or more: rejected
+		for (uint16_t op : { BPF_DIV, BPF_MOD, BPF_LSH, BPF_RSH }) {
+			for (uint32_t k : { 0u, 32u, 40u }) {
+				programs.push_back({
+					BPF_STMT(BPF_LD | BPF_IMM, 1000),
+					BPF_STMT(BPF_ALU | op | BPF_K, k),
+					BPF_STMT(BPF_RET | BPF_A, 0),
+				});
+			}
+		}
+
+		// indirect loads, with X + k past the packet and wrapping around 2^32
+		for (uint16_t size : { BPF_W, BPF_H, BPF_B }) {
+			for (uint32_t x : { 0u, 14u, 60u, 1500u, 0xFFFFFFF0u, 0xFFFFFFFFu }) {
+				for (uint32_t k : { 0u, 2u, 12u, 0x20u, 0xFFFFFFFFu }) {
+					programs.push_back({
+						BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, x),
+						BPF_STMT(BPF_LD | size | BPF_IND, k),
+						BPF_STMT(BPF_RET | BPF_A, 0),
+					});
+				}
+			}
+		}
+
+		// absolute loads at and past the end of the packet
+		for (uint16_t size : { BPF_W, BPF_H, BPF_B }) {
+			for (uint32_t k : { 0u, 40u, 59u, 60u, 61u, 1513u, 0xFFFFFFFCu, 0xFFFFFFFFu }) {
+				programs.push_back({
+					BPF_STMT(BPF_LD | size | BPF_ABS, k),
+					BPF_STMT(BPF_RET | BPF_A, 0),
+				});
+				// the fused load + compare
+				programs.push_back({
+					BPF_STMT(BPF_LD | size | BPF_ABS, k),
+					BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1),
+					BPF_STMT(BPF_RET | BPF_K, 1),
+					BPF_STMT(BPF_RET | BPF_K, 2),
+				});
+			}
+		}
+
+		// ldx 4 * ([k] & 0xf), then loads relative to it: the IP header length idiom
+		for (uint32_t k : { 0u, 14u, 59u, 60u, 0xFFFFFFFFu }) {
+			programs.push_back({
+				BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, k),
+				BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),
+				BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+				BPF_STMT(BPF_RET | BPF_A, 0),
+			});
+		}
+
+		// JSET with K and X, and a jump straight into the comparison of a fused pair
+		for (uint32_t mask : { 0u, 1u, 0x12u, 0x80000000u, 0xFFFFFFFFu }) {
+			programs.push_back({
+				BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 47),
+				BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, mask, 0, 1),
+				BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+				BPF_STMT(BPF_RET | BPF_K, 0),
+			});
+			programs.push_back({
+				BPF_STMT(BPF_LDX | BPF_W | BPF_IMM, mask),
+				BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 30),
+				BPF_JUMP(BPF_JMP | BPF_JSET | BPF_X, 0, 0, 1),
+				BPF_STMT(BPF_RET | BPF_A, 0),
+				BPF_STMT(BPF_RET | BPF_K, 7),
+			});
+			programs.push_back({
+				BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+				BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 100, 1, 0),
+				BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+				BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, mask, 0, 1),
+				BPF_STMT(BPF_RET | BPF_A, 0),
+				BPF_STMT(BPF_RET | BPF_K, 3),
+			});
+		}
+
+		// scratch memory, lengths, register moves and negation
+		programs.push_back({
+			BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+			BPF_STMT(BPF_ST, 15),
+			BPF_STMT(BPF_LDX | BPF_W | BPF_LEN, 0),
+			BPF_STMT(BPF_STX, 0),
+			BPF_STMT(BPF_LD | BPF_MEM, 0),
+			BPF_STMT(BPF_ALU | BPF_NEG, 0),
+			BPF_STMT(BPF_MISC | BPF_TAX, 0),
+			BPF_STMT(BPF_LD | BPF_MEM, 15),
+			BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+			BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 15),
+			BPF_STMT(BPF_MISC | BPF_TXA, 0),
+			BPF_JUMP(BPF_JMP | BPF_JGE | BPF_X, 0, 0, 1),
+			BPF_STMT(BPF_RET | BPF_A, 0),
+			BPF_STMT(BPF_RET | BPF_K, 0),
+		});
+
+		// malformed programs: rejected by both
+		programs.push_back({ BPF_STMT(BPF_LD | BPF_MEM, BPF_MEMWORDS), BPF_STMT(BPF_RET | BPF_A, 0) });
+		programs.push_back({ BPF_STMT(BPF_ST, BPF_MEMWORDS), BPF_STMT(BPF_RET | BPF_A, 0) });
+		programs.push_back({ BPF_STMT(BPF_JMP | BPF_JA, 1), BPF_STMT(BPF_RET | BPF_A, 0) });
+		programs.push_back({ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 2), BPF_STMT(BPF_RET | BPF_A, 0) });
+		programs.push_back({ BPF_STMT(BPF_LD | BPF_IMM, 1) });
+
+		for (std::size_t i = 0; i < programs.size(); ++i) {
+			const std::string what = "crafted program " + std::to_string(i);
+			if (!check(what.c_str(), programs[i], packets, stats))
+				return false;
+		}
+		return true;
+	}
+
+	bpf_insn stmt(uint16_t code, uint32_t k)
+	{
+		return bpf_insn BPF_STMT(code, k);
+	}
+
+	bpf_insn jump(uint16_t code, uint32_t k, uint32_t jt, uint32_t jf)
+	{
+		return bpf_insn BPF_JUMP(code, k, static_cast<u_char>(jt), static_cast<u_char>(jf));
+	}
+
+	// Straight-line random programs with forward jumps. Scratch memory is written first, since
+	// neither interpreter defines what an unwritten slot holds.
+	std::vector<bpf_insn> random_program(std::mt19937& rng)
+	{
+		static const uint16_t sizes[] = { BPF_W, BPF_H, BPF_B };
+		static const uint16_t alu_ops[] = { BPF_ADD, BPF_SUB, BPF_MUL, BPF_DIV, BPF_MOD, BPF_AND, BPF_OR, BPF_XOR, BPF_LSH, BPF_RSH };
+		static const uint16_t jmp_ops[] = { BPF_JEQ, BPF_JGT, BPF_JGE, BPF_JSET };
+		static const uint32_t constants[] = { 0, 1, 2, 4, 14, 31, 32, 33, 0x0800, 0x86DD, 0xFF, 0xFFFF, 0x80000000u, 0xFFFFFFFFu };
+
+		const auto constant = [&]() { return rng() % 2 ? constants[rng() % (sizeof constants / sizeof *constants)] : static_cast<uint32_t>(rng()); };
+		const auto offset = [&]() { return static_cast<uint32_t>(rng() % 8 ? rng() % 80 : (rng() % 2 ? 1500 + rng() % 100 : 0xFFFFFFFFu - rng() % 8)); };
+
+		std::vector<bpf_insn> code;
+		code.push_back(stmt(BPF_LD | BPF_IMM, constant()));
+		for (uint32_t i = 0; i < BPF_MEMWORDS; ++i)
+			code.push_back(stmt(BPF_ST, i));
+		code.push_back(stmt(BPF_LDX | BPF_W | BPF_IMM, constant()));
+
+		const std::size_t body = 1 + rng() % 32;
+		const std::size_t n = code.size() + body + 2;
+
+		while (code.size() < n - 2) {
+			const std::size_t left = n - code.size() - 1;	// instructions a jump from here can skip
+			const uint16_t size = sizes[rng() % 3];
+
+			switch (rng() % 16) {
+			case 0: case 1:
+				code.push_back(stmt(BPF_LD | size | BPF_ABS, offset()));
+				if (rng() % 2 && left > 1)
+					code.push_back(jump(BPF_JMP | (rng() % 2 ? BPF_JEQ : BPF_JSET) | BPF_K, constant(),
+						static_cast<uint32_t>(rng() % (left - 1)), static_cast<uint32_t>(rng() % (left - 1))));
+				break;
+			case 2: code.push_back(stmt(BPF_LD | size | BPF_IND, offset())); break;
+			case 3: code.push_back(stmt(BPF_LDX | BPF_B | BPF_MSH, offset())); break;
+			case 4: code.push_back(stmt(rng() % 2 ? BPF_LD | BPF_W | BPF_LEN : BPF_LDX | BPF_W | BPF_LEN, 0)); break;
+			case 5: code.push_back(stmt(rng() % 2 ? BPF_LD | BPF_IMM : BPF_LDX | BPF_W | BPF_IMM, constant())); break;
+			case 6: code.push_back(stmt(rng() % 2 ? BPF_LD | BPF_MEM : BPF_LDX | BPF_W | BPF_MEM, static_cast<uint32_t>(rng() % BPF_MEMWORDS))); break;
+			case 7: code.push_back(stmt(rng() % 2 ? BPF_ST : BPF_STX, static_cast<uint32_t>(rng() % BPF_MEMWORDS))); break;
+			case 8: {
+				const uint16_t op = alu_ops[rng() % 10];
+				uint32_t k = constant();
+				if ((op == BPF_DIV || op == BPF_MOD) && k == 0 && rng() % 8) k = 3;
+				if ((op == BPF_LSH || op == BPF_RSH) && rng() % 8) k %= 32;
+				code.push_back(stmt(BPF_ALU | op | BPF_K, k));
+				break;
+			}
+			case 9: case 10: code.push_back(stmt(BPF_ALU | alu_ops[rng() % 10] | BPF_X, 0)); break;
+			case 11: code.push_back(stmt(rng() % 2 ? BPF_MISC | BPF_TAX : (rng() % 2 ? BPF_MISC | BPF_TXA : BPF_ALU | BPF_NEG), 0)); break;
+			case 12:
+				code.push_back(stmt(BPF_JMP | BPF_JA, static_cast<uint32_t>(rng() % left)));
+				break;
+			case 13: case 14:
+				code.push_back(jump(BPF_JMP | jmp_ops[rng() % 4] | (rng() % 2 ? BPF_K : BPF_X), constant(),
+					static_cast<uint32_t>(rng() % left), static_cast<uint32_t>(rng() % left)));
+				break;
+			default:
+				code.push_back(rng() % 2 ? stmt(BPF_RET | BPF_A, 0) : stmt(BPF_RET | BPF_K, constant()));
+				break;
+			}
+		}
+		code.resize(n - 2);
+		code.push_back(stmt(BPF_RET | BPF_A, 0));
+		code.push_back(stmt(BPF_RET | BPF_K, rng() % 2 ? 0u : 0xFFFFu));
+
+		// now and then break the program on purpose
+		if (rng() % 64 == 0) {
+			bpf_insn& i = code[code.size() - 3];
+			switch (rng() % 3) {
+			case 0: i = stmt(BPF_JMP | BPF_JA, static_cast<uint32_t>(2 + rng() % 4)); break;
+			case 1: i = stmt(BPF_LD | BPF_MEM, static_cast<uint32_t>(BPF_MEMWORDS + rng() % 4)); break;
+			default: code.pop_back(); code.back() = stmt(BPF_ALU | BPF_ADD | BPF_K, 1); break;
+			}
+		}
+		return code;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint64_t random_programs = 100000;
+	unsigned seed = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--programs" && i + 1 < argc) random_programs = std::stoull(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(std::stoul(argv[++i]));
+		else {
+			std::cerr << "usage: " << argv[0] << " [--programs N] [--seed S]" << std::endl;
+			return -1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	const std::vector<packet> packets = make_packets(rng);
+	check_stats stats;
+
+	if (!check_expressions(packets, stats) || !check_crafted(packets, stats))
+		return 1;
+
+	for (uint64_t i = 0; i < random_programs; ++i) {
+		const std::string what = "random program " + std::to_string(i) + " (seed " + std::to_string(seed) + ")";
+		if (!check(what.c_str(), random_program(rng), packets, stats))
+			return 1;
+	}
+
+	std::cout << stats.programs << " programs, " << stats.runs << " runs over " << packets.size() << " packets agree; "
+		<< stats.rejected << " rejected by both, " << stats.evaluator_only << " rejected by the evaluator only" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#include "noname/concurrent/concurrent_unordered_map.hpp"
+
+// Checks concurrent_unordered_map: concurrent inserts of overlapping keys, erase / reinsert / compact,
+// the submap limit, copy / move / swap, growth factors below and above 2, and snapshot coherence
+// while values are updated. Build it with -fsanitize=thread as well; such builds take the
+// NONAME_MAP_TSAN paths of the map.
+// usage: map_check [--keys N] [--threads N] [--seed S]
+// It exits with 1 on the first failed check.
+
+namespace {
+	using map = noname_core::concurrent::concurrent_unordered_map<uint64_t, uint64_t>;
+
+	struct pair_value {
+		uint64_t a;
+		uint64_t b;
+	};
+
+	using pair_map = noname_core::concurrent::concurrent_unordered_map<uint64_t, pair_value>;
+
+	// keeps a and b apart for a while, so a snapshot that ignores the group version would see it
+	void update_pair(pair_value& v)
+	{
+		v.a++;
+		for (volatile int spin = 0; spin < 64; spin = spin + 1) {}
+		v.b = v.a;
+	}
+
+	static_assert(std::is_nothrow_move_constructible<map>::value, "moving a map must not throw");
+	static_assert(std::is_nothrow_move_assignable<map>::value, "moving a map must not throw");
+
+	bool fail(const std::string& check, const std::string& what)
+	{
+		std::cerr << check << ": " << what << std::endl;
+		return false;
+	}
+
+	uint64_t value_of(uint64_t key)
+	{
+		return key * 3 + 1;
+	}
+
+	// contents as seen by iteration; false when a key is visited twice
+	bool get_contents(const map& m, std::map<uint64_t, uint64_t>& contents)
+	{
+		contents.clear();
+		for (const auto& e : m) {
+			if (!contents.emplace(e.first, e.second).second) return false;
+		}
+		return true;
+	}
+
+	// iteration, find and size() all agree with expected
+	bool check_equal(const std::string& check, const map& m, const std::map<uint64_t, uint64_t>& expected)
+	{
+		std::map<uint64_t, uint64_t> contents;
+		if (!get_contents(m, contents))
+			return fail(check, "iteration visits a key twice");
+		if (contents != expected)
+			return fail(check, "iteration sees " + std::to_string(contents.size()) + " entries, expected " + std::to_string(expected.size()));
+		if (m.size() != expected.size())
+			return fail(check, "size() is " + std::to_string(m.size()) + ", expected " + std::to_string(expected.size()));
+
+		for (const auto& e : expected) {
+			const auto it = m.find(e.first);
+			if (it == m.end() || it->second != e.second)
+				return fail(check, "find misses key " + std::to_string(e.first));
+		}
+		return true;
+	}
+
+	// every thread inserts all keys in its own order, starting from a minimal map so it grows meanwhile
+	bool check_concurrent_inserts(std::size_t num_keys, std::size_t num_threads, unsigned seed)
+	{
+		const std::string check = "concurrent inserts";
+		map m;
+		std::atomic<std::size_t> inserted(0);
+		std::atomic<bool> lookup_failed(false);
+
+		std::vector<std::thread> threads;
+		for (std::size_t t = 0; t < num_threads; ++t) {
+			threads.emplace_back([&, t]() {
+				std::vector<uint64_t> keys(num_keys);
+				for (std::size_t i = 0; i < num_keys; ++i) keys[i] = i * 0x9E3779B97F4A7C15ull;
+				std::shuffle(keys.begin(), keys.end(), std::mt19937(seed + static_cast<unsigned>(t)));
+
+				for (uint64_t key : keys) {
+					const auto result = m.insert(key, value_of(key));
+					if (result.second) inserted++;
+					if (result.first->first != key || result.first->second != value_of(key) || m.find(key) == m.end())
+						lookup_failed = true;
+				}
+			});
+		}
+		for (auto& thread : threads) thread.join();
+
+		if (lookup_failed)
+			return fail(check, "an insert returned, or a find missed, the wrong entry");
+		if (inserted != num_keys)
+			return fail(check, std::to_string(inserted) + " inserts succeeded for " + std::to_string(num_keys) + " keys");
+
+		std::map<uint64_t, uint64_t> expected;
+		for (std::size_t i = 0; i < num_keys; ++i) {
+			const uint64_t key = i * 0x9E3779B97F4A7C15ull;
+			expected[key] = value_of(key);
+		}
+		return check_equal(check, m, expected);
+	}
+
+	bool check_erase_compact(std::size_t num_keys)
+	{
+		const std::string check = "erase / reinsert / compact";
+		map m;
+		std::map<uint64_t, uint64_t> expected;
+
+		for (uint64_t key = 0; key < num_keys; ++key) {
+			m.insert(key, value_of(key));
+			expected[key] = value_of(key);
+		}
+
+		for (uint64_t key = 1; key < num_keys; key += 2) {
+			if (m.erase(key) != 1)
+				return fail(check, "erase misses key " + std::to_string(key));
+			if (m.erase(key) != 0)
+				return fail(check, "key " + std::to_string(key) + " erased twice");
+			expected.erase(key);
+		}
+		if (!check_equal(check + " (after erase)", m, expected))
+			return false;
+
+		std::size_t tombstones = 0;
+		for (const auto& submap : m.get_stats().submaps_stats) tombstones += submap.num_deleted_buckets;
+		if (tombstones != num_keys / 2)
+			return fail(check, std::to_string(tombstones) + " tombstones after erasing " + std::to_string(num_keys / 2) + " keys");
+
+		for (uint64_t key = 1; key < num_keys; key += 4) {
+			if (!m.insert(key, key).second)
+				return fail(check, "reinsert of key " + std::to_string(key) + " found the erased entry");
+			expected[key] = key;
+		}
+		if (!check_equal(check + " (after reinsert)", m, expected))
+			return false;
+
+		m.compact();
+		const noname_core::concurrent::Stats stats = m.get_stats();
+		if (stats.num_submaps != 1 || stats.submaps_stats[0].num_deleted_buckets != 0)
+			return fail(check, "compact left " + std::to_string(stats.num_submaps) + " submaps and tombstones");
+		if (!check_equal(check + " (after compact)", m, expected))
+			return false;
+
+		m.clear();
+		return check_equal(check + " (after clear)", m, {});
+	}
+
+	bool check_submap_limit()
+	{
+		const std::string check = "submap limit";
+
+		noname_core::concurrent::Growth_policy policy;
+		policy.max_num_submaps = 3;
+		map m(0, 0.75f, policy);
+		std::map<uint64_t, uint64_t> expected;
+
+		bool threw = false;
+		for (uint64_t key = 0; key < 1000000 && !threw; ++key) {
+			try {
+				m.insert(key, value_of(key));
+				expected[key] = value_of(key);
+			}
+			catch (std::runtime_error&) {
+				threw = true;
+			}
+		}
+		if (!threw)
+			return fail(check, "no error after 1000000 inserts with 3 submaps");
+		if (m.get_stats().num_submaps != 3)
+			return fail(check, "the error came with " + std::to_string(m.get_stats().num_submaps) + " submaps");
+		if (!check_equal(check, m, expected))
+			return false;
+
+		const auto rejects = [](float load_factor, float growth_factor, std::size_t max_num_submaps) {
+			noname_core::concurrent::Growth_policy p;
+			p.growth_factor = growth_factor;
+			p.max_num_submaps = max_num_submaps;
+			try {
+				map invalid(0, load_factor, p);
+			}
+			catch (std::logic_error&) {
+				return true;
+			}
+			return false;
+		};
+		if (!rejects(0.75f, 1.0f, 16) || !rejects(0.75f, 0.5f, 16) || !rejects(1.0f, 2.0f, 16) || !rejects(0.75f, 2.0f, 0))
+			return fail(check, "an invalid load factor, growth factor or submap limit was accepted");
+		return true;
+	}
+
+	bool check_copy_move_swap(std::size_t num_keys)
+	{
+		const std::string check = "copy / move / swap";
+
+		noname_core::concurrent::Growth_policy policy;
+		policy.growth_factor = 1.5f;
+		map original(0, 0.6f, policy);
+		std::map<uint64_t, uint64_t> expected;
+		for (uint64_t key = 0; key < num_keys; ++key) {
+			original.insert(key * 7, value_of(key));
+			expected[key * 7] = value_of(key);
+		}
+		for (uint64_t key = 0; key < num_keys; key += 3) {
+			original.erase(key * 7);
+			expected.erase(key * 7);
+		}
+
+		map copy(original);
+		if (!check_equal(check + " (copy)", copy, expected) || !check_equal(check + " (copy source)", original, expected))
+			return false;
+
+		map assigned;
+		assigned.insert(1, 1);
+		assigned = original;
+		if (!check_equal(check + " (copy assignment)", assigned, expected))
+			return false;
+
+		map moved(std::move(copy));
+		if (!check_equal(check + " (move)", moved, expected) || !check_equal(check + " (moved-from)", copy, {}))
+			return false;
+
+		// a moved-from map stays usable
+		copy.insert(5, 6);
+		if (!check_equal(check + " (moved-from reuse)", copy, { { 5, 6 } }))
+			return false;
+
+		assigned = std::move(copy);
+		if (!check_equal(check + " (move assignment)", assigned, { { 5, 6 } }) || !check_equal(check + " (move-assigned-from)", copy, {}))
+			return false;
+
+		map& self = moved;
+		moved = std::move(self);
+		if (!check_equal(check + " (self move)", moved, expected))
+			return false;
+
+		swap(moved, assigned);
+		if (!check_equal(check + " (swap)", assigned, expected) || !check_equal(check + " (swap)", moved, { { 5, 6 } }))
+			return false;
+
+		// the copy of a moved-from map is empty as well
+		const map empty_copy(copy);
+		return check_equal(check + " (copy of moved-from)", empty_copy, {});
+	}
+
+	bool check_growth(float growth_factor, bool power_of_two, std::size_t num_keys)
+	{
+		const std::string check = "growth factor " + std::to_string(growth_factor) + (power_of_two ? " (power of two)" : " (prime)");
+
+		noname_core::concurrent::Growth_policy policy;
+		policy.growth_factor = growth_factor;
+		policy.power_of_two = power_of_two;
+		map m(0, 0.75f, policy);
+		std::map<uint64_t, uint64_t> expected;
+		for (uint64_t key = 0; key < num_keys; ++key) {
+			m.insert(key, value_of(key));
+			expected[key] = value_of(key);
+		}
+		if (!check_equal(check, m, expected))
+			return false;
+
+		const noname_core::concurrent::Stats stats = m.get_stats();
+		if (stats.num_submaps < 3)
+			return fail(check, "only " + std::to_string(stats.num_submaps) + " submaps");
+
+		for (std::size_t i = 1; i < stats.num_submaps; ++i) {
+			const std::size_t previous = stats.submaps_stats[i - 1].capacity;
+			const std::size_t capacity = stats.submaps_stats[i].capacity;
+
+			if (capacity < previous * growth_factor)
+				return fail(check, "submap " + std::to_string(i) + " grew from " + std::to_string(previous) + " to " + std::to_string(capacity));
+			// a factor below 2 must not be rounded up to 2 once rounding to a group no longer dominates
+			if (growth_factor < 2.0f && previous >= 256 && capacity >= 2 * previous)
+				return fail(check, "submap " + std::to_string(i) + " doubled from " + std::to_string(previous) + " to " + std::to_string(capacity));
+		}
+		return true;
+	}
+
+	// Writers keep a == b in every value through update and upsert_batch; snapshots must never see
+	// them differ, nor a value go back.
+	bool check_snapshots(std::size_t num_threads)
+	{
+		const std::string check = "snapshot coherence";
+		constexpr uint64_t NUM_KEYS = 512;
+		constexpr uint64_t ROUNDS = 400;
+
+		pair_map m;
+		for (uint64_t key = 0; key < NUM_KEYS; ++key) m.insert(key, pair_value{ 0, 0 });
+
+		const std::size_t num_writers = std::max<std::size_t>(2, num_threads - 1);
+		std::atomic<std::size_t> running(num_writers);
+		std::vector<std::thread> writers;
+
+		for (std::size_t t = 0; t < num_writers; ++t) {
+			writers.emplace_back([&, t]() {
+				std::vector<uint64_t> keys(NUM_KEYS);
+				for (uint64_t key = 0; key < NUM_KEYS; ++key) keys[key] = key;
+
+				for (uint64_t round = 0; round < ROUNDS; ++round) {
+					if (t % 2) {
+						m.upsert_batch(keys.data(), keys.size(),
+							[](std::size_t) { return pair_value{ 0, 0 }; },
+							[](std::size_t, pair_value& v) { update_pair(v); });
+					}
+					else {
+						for (uint64_t key : keys) m.update(key, update_pair);
+					}
+				}
+				running--;
+			});
+		}
+
+		std::vector<uint64_t> last(NUM_KEYS, 0);
+		bool torn = false, went_back = false, missing = false;
+		while (running) {
+			std::size_t seen = 0;
+			m.for_each_snapshot([&](uint64_t key, const pair_value& v) {
+				seen++;
+				if (v.a != v.b) torn = true;
+				if (v.a < last[key]) went_back = true;
+				last[key] = v.a;
+			});
+			if (seen != NUM_KEYS) missing = true;
+		}
+		for (auto& writer : writers) writer.join();
+
+		if (torn)
+			return fail(check, "a snapshot saw a value in the middle of an update");
+		if (went_back)
+			return fail(check, "a value went back between snapshots");
+		if (missing)
+			return fail(check, "a snapshot missed entries");
+
+		for (const auto& e : m.snapshot()) {
+			if (e.second.a != num_writers * ROUNDS || e.second.b != e.second.a)
+				return fail(check, "key " + std::to_string(e.first) + " ended at " + std::to_string(e.second.a) + ", expected " + std::to_string(num_writers * ROUNDS));
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t num_keys = 200000;
+	std::size_t num_threads = std::max(4u, std::thread::hardware_concurrency());
+	unsigned seed = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--keys" && i + 1 < argc) num_keys = std::stoull(argv[++i]);
+		else if (arg == "--threads" && i + 1 < argc) num_threads = std::stoull(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(std::stoul(argv[++i]));
+		else {
+			std::cerr << "usage: " << argv[0] << " [--keys N] [--threads N] [--seed S]" << std::endl;
+			return -1;
+		}
+	}
+	num_keys = std::max<std::size_t>(num_keys, 1000);
+	num_threads = std::max<std::size_t>(num_threads, 2);
+
+	if (!check_concurrent_inserts(num_keys, num_threads, seed)
+		|| !check_erase_compact(num_keys)
+		|| !check_submap_limit()
+		|| !check_copy_move_swap(num_keys / 4))
+		return 1;
+
+	for (float growth_factor : { 1.25f, 1.5f, 2.0f, 3.0f }) {
+		for (bool power_of_two : { true, false }) {
+			if (!check_growth(growth_factor, power_of_two, num_keys))
+				return 1;
+		}
+	}
+
+	if (!check_snapshots(num_threads))
+		return 1;
+
+	std::cout << "map checks passed: " << num_keys << " keys, " << num_threads << " threads, seed " << seed << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <random>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+
+#include "noname/network/network.hpp"
+#include "noname/network/batch_parser.hpp"
+#include "noname/network/packet_batch.hpp"
+
+// Checks that every header decoding path agrees on crafted and random frames:
+// parse_batch (8-wide AVX2 gathers when built with AVX2), packet_batch::parse and
+// parse_packet_scalar, with parse_layers as the reference for the offsets.
+// usage: parser_check [--frames N] [--seed S]
+// Run it next to pcap_bench, built with the same flags; it exits with 1 on the first batch that disagrees.
+
+namespace {
+	using frame = std::vector<uint8_t>;
+
+	struct frame_spec {
+		bool vlan = false;
+		uint16_t ether_type = noname_core::network::ethernet_header::ETHER_TYPE_IP;
+		uint8_t version = 4;
+		uint8_t ihl = 5;
+		uint8_t proto = noname_core::network::ip_header::IP_PROTO_TCP;
+		uint16_t frag = 0;
+		uint8_t tcp_doff = 5;
+		std::size_t payload = 0;
+		int total_delta = 0;	// IP total length minus the real one (padding, lies)
+	};
+
+	void put16(frame& f, std::size_t at, uint16_t v)
+	{
+		f[at] = static_cast<uint8_t>(v >> 8);
+		f[at + 1] = static_cast<uint8_t>(v);
+	}
+
+	frame build_frame(const frame_spec& s, std::mt19937& rng)
+	{
+		const std::size_t l2 = s.vlan ? 18 : 14;
+		const bool is_v6 = s.ether_type == 0x86DD;
+		const bool is_tcp = s.proto == noname_core::network::ip_header::IP_PROTO_TCP;
+		// a header length below the minimum still gets room for the fields written here
+		const std::size_t l3 = is_v6 ? 40 : std::max<std::size_t>(s.ihl * 4u, 20);
+		const std::size_t l4 = is_tcp ? std::max<std::size_t>(s.tcp_doff * 4u, 20) : 8;
+
+		frame f(l2 + l3 + l4 + s.payload);
+		for (auto& b : f) b = static_cast<uint8_t>(rng());
+
+		if (s.vlan) {
+			put16(f, 12, 0x8100);
+			put16(f, 16, s.ether_type);
+		}
+		else {
+			put16(f, 12, s.ether_type);
+		}
+
+		if (is_v6) {
+			f[l2] = 0x60;
+			f[l2 + 6] = s.proto;
+			return f;
+		}
+
+		f[l2] = static_cast<uint8_t>((s.version << 4) | (s.ihl & 0x0F));
+		put16(f, l2 + 2, static_cast<uint16_t>(static_cast<int>(l3 + l4 + s.payload) + s.total_delta));
+		put16(f, l2 + 6, s.frag);
+		f[l2 + 9] = s.proto;
+		if (is_tcp)
+			f[l2 + l3 + 12] = static_cast<uint8_t>((s.tcp_doff << 4) | (f[l2 + l3 + 12] & 0x0F));
+		return f;
+	}
+
+	// every truncation of a few well-formed and malformed frames
+	void add_crafted(std::vector<frame>& frames, std::mt19937& rng)
+	{
+		using noname_core::network::ip_header;
+
+		std::vector<frame_spec> specs;
+		for (int proto : { ip_header::IP_PROTO_TCP, ip_header::IP_PROTO_UDP, 1 }) {
+			for (int ihl : { 0, 4, 5, 6, 15 }) {
+				frame_spec s;
+				s.proto = static_cast<uint8_t>(proto);
+				s.ihl = static_cast<uint8_t>(ihl);
+				s.payload = 24;
+				specs.push_back(s);
+			}
+		}
+		for (int doff : { 0, 4, 5, 8, 15 }) {
+			frame_spec s;
+			s.tcp_doff = static_cast<uint8_t>(doff);
+			s.payload = 16;
+			specs.push_back(s);
+		}
+		for (int delta : { -1000, -30, -1, 1, 20, 1000 }) {
+			frame_spec s;
+			s.total_delta = delta;
+			s.payload = 12;
+			specs.push_back(s);
+			s.proto = ip_header::IP_PROTO_UDP;
+			specs.push_back(s);
+		}
+		for (int frag : { 0x2000, 0x0001, 0x1FFF, 0x4000 }) {
+			frame_spec s;
+			s.frag = static_cast<uint16_t>(frag);
+			specs.push_back(s);
+		}
+		for (int version : { 0, 6, 15 }) {
+			frame_spec s;
+			s.version = static_cast<uint8_t>(version);
+			specs.push_back(s);
+		}
+		{
+			frame_spec s;
+			s.vlan = true;
+			specs.push_back(s);
+			s.ether_type = 0x86DD;
+			specs.push_back(s);
+			s.vlan = false;
+			specs.push_back(s);
+			s.ether_type = noname_core::network::ethernet_header::ETHER_TYPE_ARP;
+			specs.push_back(s);
+		}
+
+		for (auto& s : specs) {
+			const frame full = build_frame(s, rng);
+			for (std::size_t len = 0; len <= full.size(); ++len)
+				frames.emplace_back(full.begin(), full.begin() + len);
+		}
+	}
+
+	// random frames biased towards headers that get past the first checks
+	void add_random(std::vector<frame>& frames, std::size_t count, std::mt19937& rng)
+	{
+		using noname_core::network::ip_header;
+
+		for (std::size_t i = 0; i < count; ++i) {
+			frame_spec s;
+			s.vlan = rng() % 16 == 0;
+			s.ether_type = rng() % 16 == 0 ? 0x86DD : (rng() % 32 == 0 ? static_cast<uint16_t>(rng()) : s.ether_type);
+			s.version = rng() % 32 ? 4 : rng() % 16;
+			s.ihl = rng() % 4 ? 5 : rng() % 16;
+			s.proto = rng() % 3 ? ip_header::IP_PROTO_TCP : (rng() % 2 ? ip_header::IP_PROTO_UDP : static_cast<uint8_t>(rng()));
+			s.frag = rng() % 16 ? 0x4000 : static_cast<uint16_t>(rng());
+			s.tcp_doff = rng() % 4 ? 5 : rng() % 16;
+			s.payload = rng() % 4 ? rng() % 128 : rng() % 1500;
+			s.total_delta = rng() % 8 ? 0 : static_cast<int>(rng() % 64) - 32;
+
+			frame f = build_frame(s, rng);
+			if (rng() % 4 == 0) f.resize(rng() % (f.size() + 1));
+			frames.push_back(std::move(f));
+		}
+	}
+
+	bool compare(const noname_core::network::header_columns& a, const noname_core::network::header_columns& b, std::size_t i, const char* what, const frame& f)
+	{
+		const bool equal = a.ether_type[i] == b.ether_type[i]
+			&& a.ip_proto[i] == b.ip_proto[i]
+			&& a.src_addr[i] == b.src_addr[i]
+			&& a.des_addr[i] == b.des_addr[i]
+			&& a.src_port[i] == b.src_port[i]
+			&& a.des_port[i] == b.des_port[i]
+			&& a.l3_offset[i] == b.l3_offset[i]
+			&& a.l4_offset[i] == b.l4_offset[i]
+			&& a.payload_offset[i] == b.payload_offset[i]
+			&& a.payload_length[i] == b.payload_length[i];
+		if (equal) return true;
+
+		std::cerr << what << " disagrees with parse_packet_scalar on a " << f.size() << " byte frame:" << std::hex;
+		for (std::size_t j = 0; j < std::min<std::size_t>(f.size(), 80); ++j)
+			std::cerr << (j % 16 ? " " : "\n  ") << std::setw(2) << std::setfill('0') << static_cast<int>(f[j]);
+		std::cerr << std::dec << std::endl
+			<< "  ether_type " << a.ether_type[i] << "/" << b.ether_type[i]
+			<< " proto " << int(a.ip_proto[i]) << "/" << int(b.ip_proto[i])
+			<< " l3 " << a.l3_offset[i] << "/" << b.l3_offset[i]
+			<< " l4 " << a.l4_offset[i] << "/" << b.l4_offset[i]
+			<< " payload " << a.payload_offset[i] << "/" << b.payload_offset[i]
+			<< " length " << a.payload_length[i] << "/" << b.payload_length[i]
+			<< " ports " << a.src_port[i] << ":" << a.des_port[i] << "/" << b.src_port[i] << ":" << b.des_port[i] << std::endl;
+		return false;
+	}
+
+	bool check_layers(const noname_core::network::header_columns& c, std::size_t i, const frame& f)
+	{
+		noname_core::network::packet_layers layers;
+		noname_core::network::parse_layers(f.data(), f.size(), layers);
+
+		if (c.l3_offset[i] == layers.l3_offset && c.l4_offset[i] == layers.l4_offset
+			&& c.payload_offset[i] == layers.payload_offset && c.payload_length[i] == layers.payload_length)
+			return true;
+
+		std::cerr << "parse_packet_scalar disagrees with parse_layers on a " << f.size() << " byte frame" << std::endl;
+		return false;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	using namespace noname_core::network;
+
+	std::size_t random_frames = 1000000;
+	unsigned seed = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--frames" && i + 1 < argc) random_frames = std::stoull(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc) seed = static_cast<unsigned>(std::stoul(argv[++i]));
+		else {
+			std::cerr << "usage: " << argv[0] << " [--frames N] [--seed S]" << std::endl;
+			return -1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	std::vector<frame> frames;
+	add_crafted(frames, rng);
+	const std::size_t crafted = frames.size();
+	add_random(frames, random_frames, rng);
+
+	auto expected = std::make_unique<header_columns>();
+	auto batched = std::make_unique<header_columns>();
+	auto batch = std::make_unique<packet_batch>();
+
+	for (std::size_t begin = 0; begin < frames.size(); begin += MAX_BATCH_SIZE) {
+		const std::size_t n = std::min(MAX_BATCH_SIZE, frames.size() - begin);
+
+		// every frame is its own allocation, so a read past caplen is visible to a sanitizer
+		const uint8_t* ptrs[MAX_BATCH_SIZE];
+		uint32_t caplens[MAX_BATCH_SIZE];
+		batch->clear();
+		for (std::size_t i = 0; i < n; ++i) {
+			const frame& f = frames[begin + i];
+			ptrs[i] = f.data();
+			caplens[i] = static_cast<uint32_t>(f.size());
+			parse_packet_scalar(ptrs[i], caplens[i], *expected, i);
+			batch->push(0, caplens[i], caplens[i], ptrs[i]);
+		}
+
+		parse_batch(ptrs, caplens, n, *batched);
+		batch->parse();
+
+		for (std::size_t i = 0; i < n; ++i) {
+			const frame& f = frames[begin + i];
+			if (!check_layers(*expected, i, f)
+				|| !compare(*batched, *expected, i, "parse_batch", f)
+				|| !compare(batch->headers, *expected, i, "packet_batch::parse", f))
+				return 1;
+		}
+	}
+
+#ifdef __AVX2__
+	const char* path = "AVX2";
+#else
+	const char* path = "scalar (build with AVX2 to check the gather path)";
+#endif
+	std::cout << frames.size() << " frames (" << crafted << " crafted, seed " << seed << ") agree, batch path: " << path << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#include "noname/network/network.hpp"
+#include "noname/network/batch_parser.hpp"
+#include "noname/channel/channel.hpp"
+#include "noname/concurrent/concurrent_unordered_map.hpp"
+
+// Micro-benchmarks for the channel, circular_buffer, concurrent_unordered_map and header decoding.
+// usage: pcap_bench [-o results.json] [--quick]
+// Results are written as a JSON array so runs of two commits can be diffed by a script.
+
+using bench_clock = std::chrono::steady_clock;
+
+namespace {
+	volatile uint64_t sink;
+
+	uint64_t now_ns()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count();
+	}
+
+	struct bench_result {
+		std::string name;
+		std::vector<std::pair<std::string, std::string>> params;
+		uint64_t ops = 0;
+		double seconds = 0.0;
+		std::vector<uint64_t> latencies_ns;		// optional per-item samples
+
+		template <typename T>
+		bench_result& param(const std::string& key, const T& value)
+		{
+			std::ostringstream ss;
+			ss << value;
+			params.emplace_back(key, ss.str());
+			return *this;
+		}
+	};
+
+	uint64_t percentile(std::vector<uint64_t>& samples, double p)
+	{
+		if (samples.empty()) return 0;
+		const std::size_t k = std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()));
+		std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+		return samples[k];
+	}
+
+	void write_json(std::ostream& os, std::vector<bench_result>& results)
+	{
+		os << "[" << std::endl;
+		for (std::size_t i = 0; i < results.size(); ++i) {
+			bench_result& r = results[i];
+			os << "  {\"name\": \"" << r.name << "\", \"params\": {";
+			for (std::size_t j = 0; j < r.params.size(); ++j)
+				os << (j ? ", " : "") << "\"" << r.params[j].first << "\": \"" << r.params[j].second << "\"";
+			os << "}, \"ops\": " << r.ops
+				<< std::fixed << std::setprecision(6) << ", \"seconds\": " << r.seconds
+				<< std::setprecision(1) << ", \"ops_per_sec\": " << (r.seconds > 0 ? r.ops / r.seconds : 0.0)
+				<< std::setprecision(3) << ", \"ns_per_op\": " << (r.ops ? r.seconds * 1e9 / r.ops : 0.0);
+
+			if (!r.latencies_ns.empty()) {
+				os << ", \"latency_ns\": {\"p50\": " << percentile(r.latencies_ns, 0.50)
+					<< ", \"p90\": " << percentile(r.latencies_ns, 0.90)
+					<< ", \"p99\": " << percentile(r.latencies_ns, 0.99)
+					<< ", \"max\": " << percentile(r.latencies_ns, 1.0) << "}";
+			}
+			os << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+		}
+		os << "]" << std::endl;
+	}
+
+	// runs fn(thread_index) on n threads released together and returns the wall time in seconds
+	double run_threads(int n, const std::function<void(int)>& fn)
+	{
+		std::atomic<int> ready(0);
+		std::atomic<bool> go(false);
+		std::vector<std::thread> threads;
+
+		for (int i = 0; i < n; ++i) {
+			threads.emplace_back([&, i]() {
+				ready++;
+				while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+				fn(i);
+			});
+		}
+		while (ready.load() != n) std::this_thread::yield();
+
+		const auto start = bench_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& t : threads) t.join();
+		return std::chrono::duration<double>(bench_clock::now() - start).count();
+	}
+}
+
+// ---- channel / circular_buffer ----------------------------------------------------------------
+
+struct bench_item {
+	uint64_t sent_ns;	// 0 marks end of stream (the channel returns T{} once closed)
+	uint64_t seq;
+};
+
+constexpr std::size_t BENCH_CHANNEL_SIZE = 64;
+
+bench_result bench_circular_buffer(uint64_t items)
+{
+	noname_core::channel::circular_buffer<bench_item, BENCH_CHANNEL_SIZE> buffer;
+	uint64_t sum = 0;
+
+	const auto start = bench_clock::now();
+	for (uint64_t i = 0; i < items; ++i) {
+		if (buffer.full()) {
+			sum += buffer.front().seq;
+			buffer.pop();
+		}
+		buffer.push(bench_item{ 1, i });
+	}
+	while (!buffer.empty()) {
+		sum += buffer.front().seq;
+		buffer.pop();
+	}
+	const double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+	sink = sum;
+
+	bench_result r;
+	r.name = "circular_buffer/push_pop";
+	r.param("capacity", BENCH_CHANNEL_SIZE);
+	r.ops = items;
+	r.seconds = seconds;
+	return r;
+}
+
+// producers and consumers share one channel; 1:1, 1:N and N:1 are all instances of this
+bench_result bench_channel(int producers, int consumers, uint64_t items)
+{
+	noname_core::channel::channel<bench_item, BENCH_CHANNEL_SIZE> chan;
+	std::vector<std::vector<uint64_t>> latencies(consumers);
+	std::atomic<int> producers_left(producers);
+	const uint64_t per_producer = items / producers;
+
+	const double seconds = run_threads(producers + consumers, [&](int t) {
+		if (t < producers) {
+			for (uint64_t i = 0; i < per_producer; ++i)
+				chan << bench_item{ now_ns(), i };
+			if (--producers_left == 0) chan.close();
+			return;
+		}
+
+		std::vector<uint64_t>& samples = latencies[t - producers];
+		samples.reserve(per_producer * producers / consumers + 1);
+		while (1) {
+			bench_item item;
+			chan >> item;
+			if (item.sent_ns == 0) break;
+			samples.push_back(now_ns() - item.sent_ns);
+		}
+	});
+
+	bench_result r;
+	r.name = "channel/throughput";
+	r.param("producers", producers).param("consumers", consumers).param("buffer_size", BENCH_CHANNEL_SIZE);
+	r.ops = per_producer * producers;
+	r.seconds = seconds;
+	for (auto& l : latencies)
+		r.latencies_ns.insert(r.latencies_ns.end(), l.begin(), l.end());
+	return r;
+}
+
+// ---- concurrent_unordered_map -----------------------------------------------------------------
+
+using bench_map = noname_core::concurrent::concurrent_unordered_map<uint64_t, uint64_t>;
+
+std::vector<uint64_t> make_keys(std::size_t n, uint64_t seed)
+{
+	std::mt19937_64 rng(seed);
+	std::vector<uint64_t> keys(n);
+	for (auto& k : keys) k = rng();
+	return keys;
+}
+
+// threads insert interleaved slices of one key set, so they contend on the same submap
+std::vector<bench_result> bench_map_ops(int threads, std::size_t keys_count, float load_factor)
+{
+	std::vector<bench_result> results;
+	const std::vector<uint64_t> keys = make_keys(keys_count, 42);
+	const std::vector<uint64_t> misses = make_keys(keys_count, 43);
+	bench_map map(0, load_factor);
+
+	const auto tag = [&](bench_result& r) {
+		r.param("threads", threads).param("keys", keys_count).param("max_load_factor", load_factor);
+	};
+
+	bench_result insert;
+	insert.name = "concurrent_unordered_map/insert";
+	tag(insert);
+	insert.ops = keys_count;
+	insert.seconds = run_threads(threads, [&](int t) {
+		for (std::size_t i = t; i < keys.size(); i += threads)
+			map.insert(keys[i], keys[i]);
+	});
+	results.push_back(insert);
+
+	bench_result find_hit;
+	find_hit.name = "concurrent_unordered_map/find_hit";
+	tag(find_hit);
+	find_hit.ops = keys_count * threads;
+	find_hit.seconds = run_threads(threads, [&](int t) {
+		uint64_t found = 0;
+		for (std::size_t i = 0; i < keys.size(); ++i)
+			found += map.find(keys[(i + t * 7919) % keys.size()]) != map.end();
+		sink = found;
+	});
+	results.push_back(find_hit);
+
+	bench_result find_miss;
+	find_miss.name = "concurrent_unordered_map/find_miss";
+	tag(find_miss);
+	find_miss.ops = keys_count * threads;
+	find_miss.seconds = run_threads(threads, [&](int t) {
+		uint64_t found = 0;
+		for (std::size_t i = 0; i < misses.size(); ++i)
+			found += map.find(misses[(i + t * 7919) % misses.size()]) != map.end();
+		sink = found;
+	});
+	results.push_back(find_miss);
+
+	bench_result mixed;
+	mixed.name = "concurrent_unordered_map/insert_find_mixed";
+	tag(mixed);
+	mixed.ops = keys_count * 2;
+	mixed.seconds = run_threads(threads, [&](int t) {
+		uint64_t found = 0;
+		for (std::size_t i = t; i < misses.size(); i += threads) {
+			map.insert(misses[i], misses[i]);
+			found += map.find(keys[i]) != map.end();
+		}
+		sink = found;
+	});
+	results.push_back(mixed);
+
+	bench_result iterate;
+	iterate.name = "concurrent_unordered_map/iterate";
+	tag(iterate);
+	iterate.ops = map.size();
+	const auto start = bench_clock::now();
+	uint64_t sum = 0;
+	for (auto& e : map) sum += e.second;
+	iterate.seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+	sink = sum;
+	results.push_back(iterate);
+
+	bench_result partitioned;
+	partitioned.name = "concurrent_unordered_map/iterate_partitioned";
+	tag(partitioned);
+	partitioned.ops = map.size();
+	std::vector<uint64_t> sums(threads * 8);	// one cache line apart
+	const auto partitioned_start = bench_clock::now();
+	map.for_each_partition(threads, [&](std::size_t partition, const bench_map::entry& e) { sums[partition * 8] += e.second; });
+	partitioned.seconds = std::chrono::duration<double>(bench_clock::now() - partitioned_start).count();
+	sink = std::accumulate(sums.begin(), sums.end(), uint64_t(0));
+	results.push_back(partitioned);
+
+	// counting workload: every key is upserted twice, the second time into an existing entry
+	std::vector<std::vector<uint64_t>> slices(threads);
+	for (std::size_t i = 0; i < keys.size(); ++i)
+		slices[i % threads].push_back(keys[i]);
+
+	bench_map counters(0, load_factor);
+	bench_result upsert;
+	upsert.name = "concurrent_unordered_map/upsert";
+	tag(upsert);
+	upsert.ops = keys_count * 2;
+	upsert.seconds = run_threads(threads, [&](int t) {
+		for (int pass = 0; pass < 2; ++pass) {
+			for (uint64_t key : slices[t]) {
+				const auto it = counters.insert(key, uint64_t(0)).first;
+				const_cast<uint64_t&>(it->second)++;
+			}
+		}
+	});
+	results.push_back(upsert);
+
+	bench_map batch_counters(0, load_factor);
+	bench_result upsert_batch;
+	upsert_batch.name = "concurrent_unordered_map/upsert_batch";
+	tag(upsert_batch);
+	upsert_batch.ops = keys_count * 2;
+	upsert_batch.seconds = run_threads(threads, [&](int t) {
+		for (int pass = 0; pass < 2; ++pass) {
+			batch_counters.upsert_batch(slices[t].data(), slices[t].size(),
+				[](std::size_t) { return uint64_t(0); },
+				[](std::size_t, uint64_t& value) { value++; });
+		}
+	});
+	results.push_back(upsert_batch);
+
+	return results;
+}
+
+// ---- header decoding --------------------------------------------------------------------------
+
+// ethernet + IPv4 (some with options) + TCP or UDP frames with a small payload
+std::vector<std::vector<uint8_t>> make_frames(std::size_t n)
+{
+	std::mt19937 rng(7);
+	std::vector<std::vector<uint8_t>> frames(n);
+
+	for (auto& f : frames) {
+		const bool tcp = rng() % 4 != 0;
+		const std::size_t ip_len = rng() % 8 ? 20 : 24;
+		const std::size_t l4_len = tcp ? 20 : 8;
+		const std::size_t payload = rng() % 64;
+
+		f.assign(14 + ip_len + l4_len + payload, 0);
+		for (auto& b : f) b = static_cast<uint8_t>(rng());
+
+		f[12] = 0x08; f[13] = 0x00;
+		f[14] = static_cast<uint8_t>(0x40 | (ip_len / 4));
+		const std::size_t total = ip_len + l4_len + payload;
+		f[16] = static_cast<uint8_t>(total >> 8); f[17] = static_cast<uint8_t>(total);
+		f[20] = 0x40; f[21] = 0x00;
+		f[23] = tcp ? noname_core::network::ip_header::IP_PROTO_TCP : noname_core::network::ip_header::IP_PROTO_UDP;
+		if (tcp) f[14 + ip_len + 12] = 0x50;
+	}
+	return frames;
+}
+
+template <typename Fn>
+bench_result bench_decode(const std::string& name, const std::vector<std::vector<uint8_t>>& frames, int rounds, Fn fn)
+{
+	uint64_t acc = 0;
+	const auto start = bench_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (auto& f : frames)
+			acc += fn(f.data(), static_cast<uint32_t>(f.size()));
+	const double seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+	sink = acc;
+
+	bench_result r;
+	r.name = name;
+	r.param("frames", frames.size());
+	r.ops = frames.size() * rounds;
+	r.seconds = seconds;
+	return r;
+}
+
+std::vector<bench_result> bench_headers(std::size_t frame_count, int rounds)
+{
+	using namespace noname_core::network;
+
+	std::vector<bench_result> results;
+	const auto frames = make_frames(frame_count);
+
+	// the TCP decoders read a full header, so they run over the TCP segments of the frames only,
+	// cut at the offset parse_layers found (UDP frames and IP options would put them out of bounds)
+	std::vector<std::vector<uint8_t>> segments;
+	for (auto& f : frames) {
+		packet_layers layers;
+		parse_layers(f.data(), f.size(), layers);
+		if (layers.l4_type == PacketType::TCP)
+			segments.emplace_back(f.begin() + layers.l4_offset, f.end());
+	}
+
+	results.push_back(bench_decode("decode/ethernet_header", frames, rounds, [](const uint8_t* d, uint32_t) {
+		return ethernet_header(d).get_ether_type();
+	}));
+	results.push_back(bench_decode("decode/ethernet_view", frames, rounds, [](const uint8_t* d, uint32_t) {
+		return ethernet_view(d).get_ether_type();
+	}));
+	results.push_back(bench_decode("decode/ip_header", frames, rounds, [](const uint8_t* d, uint32_t) {
+		return ip_header(d + ethernet_view::LEN).get_proto();
+	}));
+	results.push_back(bench_decode("decode/ip_view", frames, rounds, [](const uint8_t* d, uint32_t) {
+		const ip_view ip(d + ethernet_view::LEN);
+		return ip.get_src_addr() ^ ip.get_proto();
+	}));
+	results.push_back(bench_decode("decode/tcp_header", segments, rounds, [](const uint8_t* d, uint32_t) {
+		return tcp_header(d).get_des_port();
+	}));
+	results.push_back(bench_decode("decode/tcp_view", segments, rounds, [](const uint8_t* d, uint32_t) {
+		return tcp_view(d).get_des_port();
+	}));
+	results.push_back(bench_decode("decode/parse_layers", frames, rounds, [](const uint8_t* d, uint32_t caplen) {
+		packet_layers layers;
+		parse_layers(d, caplen, layers);
+		return layers.payload_offset;
+	}));
+
+	std::vector<const uint8_t*> ptrs;
+	std::vector<uint32_t> caplens;
+	for (auto& f : frames) {
+		ptrs.push_back(f.data());
+		caplens.push_back(static_cast<uint32_t>(f.size()));
+	}
+
+	auto columns = std::make_unique<header_columns>();
+	uint64_t acc = 0;
+	const auto start = bench_clock::now();
+	for (int r = 0; r < rounds; ++r) {
+		for (std::size_t i = 0; i < frames.size(); i += MAX_BATCH_SIZE) {
+			const std::size_t n = std::min(MAX_BATCH_SIZE, frames.size() - i);
+			parse_batch(ptrs.data() + i, caplens.data() + i, n, *columns);
+			acc += columns->payload_offset[n - 1];
+		}
+	}
+	sink = acc;
+
+	bench_result batch;
+	batch.name = "decode/parse_batch";
+	batch.param("frames", frames.size()).param("batch_size", MAX_BATCH_SIZE);
+	batch.ops = frames.size() * rounds;
+	batch.seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+	results.push_back(batch);
+
+	return results;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string output;
+	bool quick = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc) output = argv[++i];
+		else if (arg == "--quick") quick = true;
+		else {
+			std::cerr << "usage: " << argv[0] << " [-o results.json] [--quick]" << std::endl;
+			return -1;
+		}
+	}
+
+	const uint64_t channel_items = quick ? 100000 : 2000000;
+	const std::size_t map_keys = quick ? 50000 : 1000000;
+	const int decode_rounds = quick ? 20 : 500;
+	const int hw = std::max(2u, std::thread::hardware_concurrency());
+
+	std::vector<bench_result> results;
+
+	results.push_back(bench_circular_buffer(channel_items * 10));
+	results.push_back(bench_channel(1, 1, channel_items));
+	results.push_back(bench_channel(1, 4, channel_items));
+	results.push_back(bench_channel(4, 1, channel_items));
+
+	std::vector<int> thread_counts = { 1, std::min(4, hw), hw };
+	thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+
+	for (float load_factor : { 0.5f, 0.75f, 0.9f }) {
+		for (int threads : thread_counts) {
+			auto r = bench_map_ops(threads, map_keys, load_factor);
+			results.insert(results.end(), r.begin(), r.end());
+		}
+	}
+
+	auto decode = bench_headers(4096, decode_rounds);
+	results.insert(results.end(), decode.begin(), decode.end());
+
+	if (output.empty()) {
+		write_json(std::cout, results);
+	}
+	else {
+		std::ofstream file(output);
+		if (!file) {
+			std::cerr << "cannot open " << output << std::endl;
+			return -1;
+		}
+		write_json(file, results);
+	}
+	return 0;
+}
\ No newline at end of file
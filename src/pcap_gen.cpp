@@ -0,0 +1,503 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <pcap/dlt.h>
+
+#include "noname/network/network.hpp"
+#include "noname/network/tls.hpp"
+
+// Writes a synthetic ethernet pcap for reproducible end-to-end runs.
+// Flows to ports 80/8080 carry HTTP/1.1 requests and responses, and flows to 443 open with a
+// ClientHello (SNI + ALPN) followed by application data records, so the HTTP and TLS stages see
+// real traffic; a message that does not fit the drawn size makes its frame longer.
+// usage: pcap_gen -o out.pcap [--bytes 4G | --packets N] [--flows N] [--zipf S] [--sizes 64:0.4,576:0.2,1500:0.4]
+//                 [--ipv6 R] [--udp R] [--vlan R] [--pps N] [--seed N]
+
+namespace {
+	constexpr uint16_t ETHER_TYPE_VLAN = 0x8100;
+	constexpr uint16_t ETHER_TYPE_IPV6 = 0x86DD;
+	constexpr std::size_t VLAN_TAG_LEN = 4;
+	constexpr std::size_t IPV6_HEADER_LEN = 40;
+	constexpr std::size_t SNAPLEN = 65535;
+	constexpr std::size_t WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+	constexpr std::size_t NUM_HOSTS = 1000;
+
+	void store_be16(uint8_t* p, uint16_t v) { p[0] = static_cast<uint8_t>(v >> 8); p[1] = static_cast<uint8_t>(v); }
+	void store_be32(uint8_t* p, uint32_t v) { store_be16(p, static_cast<uint16_t>(v >> 16)); store_be16(p + 2, static_cast<uint16_t>(v)); }
+	void store_le16(uint8_t* p, uint16_t v) { p[0] = static_cast<uint8_t>(v); p[1] = static_cast<uint8_t>(v >> 8); }
+	void store_le32(uint8_t* p, uint32_t v) { store_le16(p, static_cast<uint16_t>(v)); store_le16(p + 2, static_cast<uint16_t>(v >> 16)); }
+}
+
+struct gen_options {
+	std::string output;
+	uint64_t max_bytes = 0;
+	uint64_t max_packets = 1000000;
+	std::size_t flows = 10000;
+	double zipf = 1.1;
+	std::vector<std::pair<std::size_t, double>> sizes = { { 64, 0.4 }, { 576, 0.2 }, { 1500, 0.4 } };
+	double ipv6 = 0.1;
+	double udp = 0.2;
+	double vlan = 0.05;
+	uint64_t pps = 1000000;
+	uint64_t seed = 1;
+};
+
+struct gen_flow {
+	bool ipv6;
+	bool udp;
+	bool vlan;
+	uint16_t vlan_id;
+	uint8_t client_mac[6], server_mac[6];
+	uint8_t client_ip[16], server_ip[16];
+	uint16_t client_port, server_port;
+	uint32_t seq[2];
+	uint32_t host_id;
+	uint32_t requests;
+	bool hello_sent;
+};
+
+enum class gen_app {
+	None,
+	Http,
+	Tls
+};
+
+gen_app get_app(const gen_flow& f)
+{
+	if (f.udp) return gen_app::None;
+	if (f.server_port == noname_core::network::tcp_header::TCP_PORT_HTTP || f.server_port == noname_core::network::tcp_header::TCP_PORT_HTTP_ALT)
+		return gen_app::Http;
+	if (f.server_port == noname_core::network::tcp_header::TCP_PORT_HTTPS)
+		return gen_app::Tls;
+	return gen_app::None;
+}
+
+uint64_t parse_size(const std::string& s)
+{
+	std::size_t pos = 0;
+	const double value = std::stod(s, &pos);
+	const std::string unit = s.substr(pos);
+
+	if (unit.empty()) return static_cast<uint64_t>(value);
+	if (unit == "K" || unit == "k") return static_cast<uint64_t>(value * (1ull << 10));
+	if (unit == "M" || unit == "m") return static_cast<uint64_t>(value * (1ull << 20));
+	if (unit == "G" || unit == "g") return static_cast<uint64_t>(value * (1ull << 30));
+	throw std::invalid_argument("invalid size: " + s);
+}
+
+std::vector<std::pair<std::size_t, double>> parse_sizes(const std::string& s)
+{
+	std::vector<std::pair<std::size_t, double>> sizes;
+	std::size_t begin = 0;
+
+	while (begin < s.size()) {
+		std::size_t end = s.find(',', begin);
+		if (end == std::string::npos) end = s.size();
+
+		const std::string item = s.substr(begin, end - begin);
+		const std::size_t colon = item.find(':');
+		if (colon == std::string::npos)
+			throw std::invalid_argument("invalid size mix entry: " + item);
+
+		sizes.emplace_back(std::stoul(item.substr(0, colon)), std::stod(item.substr(colon + 1)));
+		begin = end + 1;
+	}
+	if (sizes.empty())
+		throw std::invalid_argument("empty size mix");
+	return sizes;
+}
+
+bool parse_options(int argc, char* argv[], gen_options& opt)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (i + 1 >= argc) return false;
+		const std::string value = argv[++i];
+
+		if (arg == "-o") opt.output = value;
+		else if (arg == "--bytes") { opt.max_bytes = parse_size(value); opt.max_packets = 0; }
+		else if (arg == "--packets") opt.max_packets = parse_size(value);
+		else if (arg == "--flows") opt.flows = std::max<std::size_t>(1, parse_size(value));
+		else if (arg == "--zipf") opt.zipf = std::stod(value);
+		else if (arg == "--sizes") opt.sizes = parse_sizes(value);
+		else if (arg == "--ipv6") opt.ipv6 = std::stod(value);
+		else if (arg == "--udp") opt.udp = std::stod(value);
+		else if (arg == "--vlan") opt.vlan = std::stod(value);
+		else if (arg == "--pps") opt.pps = std::max<uint64_t>(1, parse_size(value));
+		else if (arg == "--seed") opt.seed = std::stoull(value);
+		else return false;
+	}
+	return !opt.output.empty() && (opt.max_bytes || opt.max_packets);
+}
+
+// Flow i is picked with probability proportional to 1 / (i + 1)^s, so a few flows carry most packets.
+class zipf_distribution {
+public:
+	zipf_distribution(std::size_t n, double s) : cdf(n)
+	{
+		double sum = 0.0;
+		for (std::size_t i = 0; i < n; ++i) {
+			sum += 1.0 / std::pow(static_cast<double>(i + 1), s);
+			cdf[i] = sum;
+		}
+		for (auto& c : cdf) c /= sum;
+	}
+
+	template <typename Rng>
+	std::size_t operator()(Rng& rng) const
+	{
+		const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+		return std::min<std::size_t>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), cdf.size() - 1);
+	}
+
+private:
+	std::vector<double> cdf;
+};
+
+gen_flow make_flow(std::mt19937_64& rng, const gen_options& opt)
+{
+	static constexpr uint16_t SERVER_PORTS[] = {
+		noname_core::network::tcp_header::TCP_PORT_HTTP,
+		noname_core::network::tcp_header::TCP_PORT_HTTPS,
+		noname_core::network::tcp_header::TCP_PORT_HTTP_ALT,
+	};
+	std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+	gen_flow f;
+	f.ipv6 = coin(rng) < opt.ipv6;
+	f.udp = coin(rng) < opt.udp;
+	f.vlan = coin(rng) < opt.vlan;
+	f.vlan_id = static_cast<uint16_t>(rng() % 4094 + 1);
+
+	for (auto* mac : { f.client_mac, f.server_mac }) {
+		for (int i = 0; i < 6; ++i) mac[i] = static_cast<uint8_t>(rng());
+		mac[0] = (mac[0] & 0xFE) | 0x02;	// locally administered unicast
+	}
+	for (auto* ip : { f.client_ip, f.server_ip }) {
+		for (int i = 0; i < 16; ++i) ip[i] = static_cast<uint8_t>(rng());
+		if (!f.ipv6) ip[0] = 10;
+	}
+
+	f.client_port = static_cast<uint16_t>(49152 + rng() % 16384);
+	if (f.udp) f.server_port = rng() % 2 ? noname_core::network::udp_header::UDP_PORT_DNS : static_cast<uint16_t>(1024 + rng() % 60000);
+	else f.server_port = rng() % 4 ? SERVER_PORTS[rng() % 3] : static_cast<uint16_t>(1024 + rng() % 60000);
+
+	f.seq[0] = static_cast<uint32_t>(rng());
+	f.seq[1] = static_cast<uint32_t>(rng());
+	f.host_id = static_cast<uint32_t>(rng() % NUM_HOSTS);
+	f.requests = 0;
+	f.hello_sent = false;
+	return f;
+}
+
+namespace {
+	// appends to a payload being written front to back
+	struct payload_writer {
+		uint8_t* p;
+
+		void put(const char* s, std::size_t n) { std::memcpy(p, s, n); p += n; }
+		void put(const std::string& s) { put(s.data(), s.size()); }
+		void put8(uint8_t v) { *p++ = v; }
+		void put16(uint16_t v) { store_be16(p, v); p += 2; }
+		void put24(uint32_t v) { put8(static_cast<uint8_t>(v >> 16)); put16(static_cast<uint16_t>(v)); }
+		void fill(char c, std::size_t n) { std::memset(p, c, n); p += n; }
+	};
+
+	std::string get_host(const gen_flow& f)
+	{
+		return "host" + std::to_string(f.host_id) + ".example";
+	}
+
+	std::size_t get_digits(std::size_t v)
+	{
+		std::size_t digits = 1;
+		while (v >= 10) { v /= 10; digits++; }
+		return digits;
+	}
+
+	const char HTTP_PAD_HEADER[] = "\r\nX-Pad: ";
+	const char HTTP_END[] = "\r\n\r\n";
+	const char TLS_ALPN[] = "\x02h2\x08http/1.1";
+
+	std::string get_request_line(const gen_flow& f)
+	{
+		return "GET /" + std::to_string(f.requests % 997) + " HTTP/1.1\r\nHost: " + get_host(f);
+	}
+
+	std::string get_status_line(const gen_flow& f)
+	{
+		// mostly 200, with a few client and server errors
+		const uint32_t r = (f.requests * 2654435761u + f.host_id) % 100;
+		return r < 90 ? "HTTP/1.1 200 OK" : r < 97 ? "HTTP/1.1 404 Not Found" : "HTTP/1.1 503 Service Unavailable";
+	}
+
+	std::size_t get_client_hello_len(const gen_flow& f)
+	{
+		const std::size_t sni = 9 + get_host(f).size();
+		const std::size_t alpn = 6 + sizeof TLS_ALPN - 1;
+		return noname_core::network::TLS_RECORD_HEADER_LEN + noname_core::network::TLS_HANDSHAKE_HEADER_LEN
+			+ 2 + 32 + 1 + 4 + 2 + 2 + sni + alpn;
+	}
+
+	void write_client_hello(const gen_flow& f, payload_writer& w)
+	{
+		const std::string host = get_host(f);
+		const std::size_t len = get_client_hello_len(f);
+		const std::size_t record_len = len - noname_core::network::TLS_RECORD_HEADER_LEN;
+
+		w.put8(noname_core::network::TLS_CONTENT_HANDSHAKE);
+		w.put16(0x0301);
+		w.put16(static_cast<uint16_t>(record_len));
+		w.put8(noname_core::network::TLS_HANDSHAKE_CLIENT_HELLO);
+		w.put24(static_cast<uint32_t>(record_len - noname_core::network::TLS_HANDSHAKE_HEADER_LEN));
+		w.put16(0x0303);
+		w.fill(0x5A, 32);			// random
+		w.put8(0);					// session_id
+		w.put16(2);
+		w.put16(0x1301);			// TLS_AES_128_GCM_SHA256
+		w.put8(1);
+		w.put8(0);					// null compression
+		w.put16(static_cast<uint16_t>(9 + host.size() + 6 + sizeof TLS_ALPN - 1));
+		w.put16(noname_core::network::TLS_EXTENSION_SERVER_NAME);
+		w.put16(static_cast<uint16_t>(5 + host.size()));
+		w.put16(static_cast<uint16_t>(3 + host.size()));
+		w.put8(0);					// host_name
+		w.put16(static_cast<uint16_t>(host.size()));
+		w.put(host);
+		w.put16(noname_core::network::TLS_EXTENSION_ALPN);
+		w.put16(static_cast<uint16_t>(2 + sizeof TLS_ALPN - 1));
+		w.put16(static_cast<uint16_t>(sizeof TLS_ALPN - 1));
+		w.put(TLS_ALPN, sizeof TLS_ALPN - 1);
+	}
+}
+
+// Smallest application payload the next packet of the flow needs.
+std::size_t get_message_len(const gen_flow& f, bool to_server)
+{
+	switch (get_app(f)) {
+	case gen_app::Http:
+		return to_server
+			? get_request_line(f).size() + sizeof HTTP_PAD_HEADER - 1 + sizeof HTTP_END - 1
+			: get_status_line(f).size() + std::strlen("\r\nContent-Length: 0") + sizeof HTTP_END - 1;
+	case gen_app::Tls:
+		return to_server && !f.hello_sent ? get_client_hello_len(f) : 0;
+	default:
+		return 0;
+	}
+}
+
+// Writes the flow's next message into exactly len (>= get_message_len) bytes.
+// HTTP requests are padded with an X-Pad header and responses carry the rest as their body, so every
+// segment is one complete message; TLS payloads after the hello are application data records.
+void write_message(gen_flow& f, bool to_server, uint8_t* payload, std::size_t len)
+{
+	payload_writer w{ payload };
+
+	switch (get_app(f)) {
+	case gen_app::Http:
+		if (to_server) {
+			const std::string line = get_request_line(f);
+			w.put(line);
+			w.put(HTTP_PAD_HEADER, sizeof HTTP_PAD_HEADER - 1);
+			w.fill('x', len - get_message_len(f, true));
+			w.put(HTTP_END, sizeof HTTP_END - 1);
+			f.requests++;
+		}
+		else {
+			const std::string head = get_status_line(f) + "\r\nContent-Length: ";
+			const std::size_t room = len - head.size() - (sizeof HTTP_END - 1);
+			std::size_t body = room - 1;
+			while (get_digits(body) + body > room) body--;
+
+			// a length that cannot fill the room exactly (10 doesn't, 9 leaves one byte) gets a space in front
+			w.put(head);
+			w.fill(' ', room - get_digits(body) - body);
+			w.put(std::to_string(body));
+			w.put(HTTP_END, sizeof HTTP_END - 1);
+			w.fill('b', body);
+		}
+		break;
+	case gen_app::Tls:
+		if (to_server && !f.hello_sent) {
+			write_client_hello(f, w);
+			f.hello_sent = true;
+		}
+		else if (len >= noname_core::network::TLS_RECORD_HEADER_LEN) {
+			w.put8(0x17);			// application_data
+			w.put16(0x0303);
+			w.put16(static_cast<uint16_t>(len - noname_core::network::TLS_RECORD_HEADER_LEN));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+std::size_t get_headers_len(const gen_flow& f)
+{
+	return noname_core::network::ethernet_view::LEN + (f.vlan ? VLAN_TAG_LEN : 0)
+		+ (f.ipv6 ? IPV6_HEADER_LEN : noname_core::network::ip_view::MIN_LEN)
+		+ (f.udp ? noname_core::network::udp_view::LEN : noname_core::network::tcp_view::MIN_LEN);
+}
+
+// Length of the next frame of the flow: at least `size` bytes, headers and message permitting.
+std::size_t get_frame_len(const gen_flow& f, bool to_server, std::size_t size)
+{
+	return std::min(SNAPLEN, std::max(size, get_headers_len(f) + get_message_len(f, to_server)));
+}
+
+// Builds the frame_len (from get_frame_len) byte frame into out.
+void build_frame(gen_flow& f, bool to_server, std::size_t frame_len, uint8_t* out)
+{
+	const std::size_t l2 = noname_core::network::ethernet_view::LEN + (f.vlan ? VLAN_TAG_LEN : 0);
+	const std::size_t l3_len = f.ipv6 ? IPV6_HEADER_LEN : noname_core::network::ip_view::MIN_LEN;
+	const std::size_t l4_len = f.udp ? noname_core::network::udp_view::LEN : noname_core::network::tcp_view::MIN_LEN;
+	const std::size_t payload_len = frame_len - l2 - l3_len - l4_len;
+
+	std::memset(out, 0, frame_len);
+
+	uint8_t* p = out;
+	std::memcpy(p, to_server ? f.server_mac : f.client_mac, 6);
+	std::memcpy(p + 6, to_server ? f.client_mac : f.server_mac, 6);
+	p += 12;
+	if (f.vlan) {
+		store_be16(p, ETHER_TYPE_VLAN);
+		store_be16(p + 2, f.vlan_id);
+		p += VLAN_TAG_LEN;
+	}
+	store_be16(p, f.ipv6 ? ETHER_TYPE_IPV6 : noname_core::network::ethernet_header::ETHER_TYPE_IP);
+	p += 2;
+
+	const uint8_t proto = f.udp ? noname_core::network::ip_header::IP_PROTO_UDP : noname_core::network::ip_header::IP_PROTO_TCP;
+	const uint8_t* src = to_server ? f.client_ip : f.server_ip;
+	const uint8_t* des = to_server ? f.server_ip : f.client_ip;
+
+	if (f.ipv6) {
+		p[0] = 0x60;
+		store_be16(p + 4, static_cast<uint16_t>(l4_len + payload_len));
+		p[6] = proto;
+		p[7] = 64;
+		std::memcpy(p + 8, src, 16);
+		std::memcpy(p + 24, des, 16);
+	}
+	else {
+		p[0] = 0x45;
+		store_be16(p + 2, static_cast<uint16_t>(l3_len + l4_len + payload_len));
+		p[6] = 0x40;	// don't fragment
+		p[8] = 64;
+		p[9] = proto;
+		std::memcpy(p + 12, src, 4);
+		std::memcpy(p + 16, des, 4);
+	}
+	p += l3_len;
+
+	store_be16(p, to_server ? f.client_port : f.server_port);
+	store_be16(p + 2, to_server ? f.server_port : f.client_port);
+	if (f.udp) {
+		store_be16(p + 4, static_cast<uint16_t>(l4_len + payload_len));
+	}
+	else {
+		uint32_t& seq = f.seq[to_server ? 0 : 1];
+		store_be32(p + 4, seq);
+		store_be32(p + 8, f.seq[to_server ? 1 : 0]);
+		p[12] = 0x50;
+		p[13] = 0x18;	// PSH | ACK
+		store_be16(p + 14, 65535);
+		seq += static_cast<uint32_t>(payload_len);
+	}
+	p += l4_len;
+
+	write_message(f, to_server, p, payload_len);
+}
+
+int main(int argc, char* argv[])
+{
+	gen_options opt;
+	try {
+		if (!parse_options(argc, argv, opt)) {
+			std::cerr << "usage: " << argv[0] << " -o out.pcap [--bytes 4G | --packets N] [--flows N] [--zipf S]"
+				<< " [--sizes 64:0.4,576:0.2,1500:0.4] [--ipv6 R] [--udp R] [--vlan R] [--pps N] [--seed N]" << std::endl;
+			return -1;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return -1;
+	}
+
+	std::ofstream file(opt.output, std::ios::binary);
+	if (!file) {
+		std::cerr << "cannot open " << opt.output << std::endl;
+		return -1;
+	}
+
+	std::mt19937_64 rng(opt.seed);
+
+	std::vector<gen_flow> flows;
+	flows.reserve(opt.flows);
+	for (std::size_t i = 0; i < opt.flows; ++i)
+		flows.push_back(make_flow(rng, opt));
+
+	const zipf_distribution pick_flow(opt.flows, opt.zipf);
+
+	std::vector<double> weights;
+	for (auto& s : opt.sizes) weights.push_back(s.second);
+	std::discrete_distribution<std::size_t> pick_size(weights.begin(), weights.end());
+
+	// little-endian libpcap file header; readers detect the byte order from the magic
+	uint8_t file_header[24] = { 0 };
+	store_le32(file_header, 0xA1B2C3D4);
+	store_le16(file_header + 4, 2);
+	store_le16(file_header + 6, 4);
+	store_le32(file_header + 16, SNAPLEN);
+	store_le32(file_header + 20, DLT_EN10MB);
+	file.write(reinterpret_cast<const char*>(file_header), sizeof file_header);
+
+	std::vector<uint8_t> buffer;
+	buffer.reserve(WRITE_BUFFER_SIZE + SNAPLEN + 16);
+
+	const uint64_t interval_nsec = 1000000000ull / opt.pps;
+	uint64_t ts_nsec = 1600000000ull * 1000000000ull;
+	uint64_t packets = 0;
+	uint64_t bytes = sizeof file_header;
+
+	while ((!opt.max_packets || packets < opt.max_packets) && (!opt.max_bytes || bytes < opt.max_bytes)) {
+		gen_flow& f = flows[pick_flow(rng)];
+		const bool to_server = rng() % 2 == 0;
+
+		// the reserve above covers a full buffer plus one record, so this never reallocates
+		const std::size_t len = get_frame_len(f, to_server, opt.sizes[pick_size(rng)].first);
+		const std::size_t record = buffer.size();
+		buffer.resize(record + 16 + len);
+		build_frame(f, to_server, len, buffer.data() + record + 16);
+
+		store_le32(buffer.data() + record, static_cast<uint32_t>(ts_nsec / 1000000000ull));
+		store_le32(buffer.data() + record + 4, static_cast<uint32_t>(ts_nsec % 1000000000ull / 1000));
+		store_le32(buffer.data() + record + 8, static_cast<uint32_t>(len));
+		store_le32(buffer.data() + record + 12, static_cast<uint32_t>(len));
+
+		if (buffer.size() >= WRITE_BUFFER_SIZE) {
+			file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+			buffer.clear();
+		}
+
+		ts_nsec += interval_nsec;
+		bytes += 16 + len;
+		packets++;
+	}
+
+	file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	if (!file) {
+		std::cerr << "write to " << opt.output << " failed" << std::endl;
+		return -1;
+	}
+
+	std::cerr << packets << " packets, " << bytes << " bytes, " << opt.flows << " flows written to " << opt.output << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -3,10 +3,18 @@
 #include <algorithm>
 #include <thread>
 #include <future>
+#include <vector>
 
 #include <pcap.h>
 
 #include "noname/network/network.hpp"
+#include "noname/network/http.hpp"
+#include "noname/network/dns.hpp"
+#include "noname/network/tls.hpp"
+#include "noname/network/packet_batch.hpp"
+#include "noname/filter/bpf_evaluator.hpp"
+#include "noname/perf/stage_timer.hpp"
+#include "noname/perf/tracer.hpp"
 #include "noname/channel/channel.hpp"
 #include "noname/concurrent/concurrent_unordered_map.hpp"
 
@@ -25,11 +33,24 @@ struct send_data {
 		rx.packet += data.rx.packet;
 		return *this;
 	}
+
+	send_data& operator+= (const send_data& data) {
+		tx.bytes += data.tx.bytes;
+		tx.packet += data.tx.packet;
+		rx.bytes += data.rx.bytes;
+		rx.packet += data.rx.packet;
+		return *this;
+	}
 };
 
-struct Packet {
-	struct pcap_pkthdr* header;
-	const uint8_t* data;
+using Batch = std::shared_ptr<noname_core::network::packet_batch>;
+
+struct worker_perf {
+	noname_core::perf::stage_stats stage;
+	bool use_counters = false;
+	noname_core::perf::hw_counter_values parse;
+	noname_core::perf::hw_counter_values aggregate;
+	noname_core::perf::hw_counter_values merge;
 };
 
 void setup_map(
@@ -57,45 +78,191 @@ void setup_map(
 	}
 }
 
+// Workers can see the same key; upsert_batch serializes their updates of it.
+void merge_stats(
+	noname_core::concurrent::concurrent_unordered_map<std::pair<std::string, std::string>, send_data>& ret,
+	const std::map<std::pair<std::string, std::string>, send_data>& stat
+)
+{
+	std::vector<std::pair<std::string, std::string>> keys;
+	std::vector<const send_data*> values;
+	keys.reserve(stat.size());
+	values.reserve(stat.size());
+
+	for (auto& i : stat) {
+		keys.push_back(i.first);
+		values.push_back(&i.second);
+	}
+
+	ret.upsert_batch(keys.data(), keys.size(),
+		[](std::size_t) { return send_data{}; },
+		[&values](std::size_t i, send_data& data) { data += *values[i]; });
+}
+
+noname_core::network::flow_key make_flow(
+	uint32_t src_addr,
+	uint32_t des_addr,
+	uint16_t src_port,
+	uint16_t des_port,
+	bool to_server
+)
+{
+	noname_core::network::flow_key flow;
+	flow.client_ip = to_server ? src_addr : des_addr;
+	flow.server_ip = to_server ? des_addr : src_addr;
+	flow.client_port = to_server ? src_port : des_port;
+	flow.server_port = to_server ? des_port : src_port;
+	return flow;
+}
+
 int get_stats(
 	noname_core::concurrent::concurrent_unordered_map<std::pair<std::string, std::string>, send_data>& ret_mac,
 	noname_core::concurrent::concurrent_unordered_map<std::pair<std::string, std::string>, send_data>& ret_ip,
 	noname_core::concurrent::concurrent_unordered_map<std::pair<std::string, std::string>, send_data>& ret_port,
-	noname_core::channel::channel<Packet, 10>& input_chan
+	noname_core::network::http_analyzer& http,
+	noname_core::network::dns_analyzer& dns,
+	noname_core::network::tls_analyzer& tls,
+	noname_core::channel::channel<Batch, 10>& input_chan,
+	worker_perf* perf
 	)
 {
 	std::map<std::pair<std::string, std::string>, send_data> mac_stat, ip_stat, port_stat;
+	noname_core::perf::stage_timer timer(perf ? &perf->stage : nullptr);
+
+	noname_core::perf::tracer::instance().set_thread_name(perf ? perf->stage.name : "worker");
+
+	// counter groups are per thread, so they have to be opened here
+	noname_core::perf::hw_counter_group parse_counters, aggregate_counters, merge_counters;
+	if (perf && perf->use_counters) {
+		parse_counters.open();
+		aggregate_counters.open();
+		merge_counters.open();
+	}
+
+	timer.start();
 
 	while (1) {
-		Packet packet;
-		input_chan >> packet;
+		Batch batch;
+		timer.idle([&]() { input_chan >> batch; });
 
-		if (packet.data == nullptr && packet.header == nullptr)
+		if (batch == nullptr)
 			break;
 
-		noname_core::network::ethernet_header ether(packet.data);
-		setup_map(mac_stat, ether.get_source().to_string(), ether.get_destination().to_string(), packet.header->caplen);
+		{
+			noname_core::perf::trace_scope trace("parse");
+			noname_core::perf::hw_counter_scope scope(&parse_counters);
+			batch->parse();
+		}
+
+		noname_core::perf::trace_scope trace("aggregate");
+		noname_core::perf::hw_counter_scope scope(&aggregate_counters);
+		const noname_core::network::header_columns& h = batch->headers;
+		uint64_t wire_bytes = 0;
+
+		for (std::size_t i = 0; i < batch->size(); ++i) {
+			const uint8_t* data = batch->get_data(i);
+			const uint32_t caplen = batch->caplen[i];
+			wire_bytes += batch->wirelen[i];
+
+			if (caplen < noname_core::network::ethernet_view::LEN)
+				continue;
+
+			noname_core::network::ethernet_view ether(data);
+			setup_map(mac_stat, ether.get_source().to_string(), ether.get_destination().to_string(), caplen);
+
+			if (!h.l3_offset[i])
+				continue;
+
+			noname_core::network::ip_view ip(data + h.l3_offset[i]);
+			setup_map(ip_stat, ip.get_src_ip().to_string(), ip.get_des_ip().to_string(), caplen);
+
+			if (!h.l4_offset[i])
+				continue;
+
+			const uint16_t src_port = h.src_port[i];
+			const uint16_t des_port = h.des_port[i];
+			const uint8_t* payload = data + h.payload_offset[i];
+
+			if (h.ip_proto[i] == noname_core::network::ip_header::IP_PROTO_UDP) {
+				if (noname_core::network::udp_header::get_packet_type(src_port, des_port) == noname_core::network::PacketType::DNS) {
+					// resolvers talk port 53 to port 53, so the QR bit tells the direction when there is a header
+					const bool to_server = h.payload_length[i] >= noname_core::network::DNS_HEADER_LEN
+						? !noname_core::network::is_dns_response(payload)
+						: des_port == noname_core::network::udp_header::UDP_PORT_DNS;
+
+					dns.process(
+						make_flow(h.src_addr[i], h.des_addr[i], src_port, des_port, to_server),
+						to_server,
+						payload,
+						h.payload_length[i],
+						batch->ts_usec[i]
+					);
+				}
+				continue;
+			}
+
+			setup_map(
+				port_stat, 
+				std::to_string(src_port), 
+				std::to_string(des_port), 
+				caplen
+			);
+
+			const noname_core::network::PacketType app_type = noname_core::network::tcp_header::get_packet_type(src_port, des_port);
+			if (app_type == noname_core::network::PacketType::UNKNOWN)
+				continue;
+
+			if (app_type == noname_core::network::PacketType::TLS) {
+				const bool to_server = des_port == noname_core::network::tcp_header::TCP_PORT_HTTPS;
+
+				const noname_core::network::tcp_view tcp(data + h.l4_offset[i]);
+
+				tls.process(
+					make_flow(h.src_addr[i], h.des_addr[i], src_port, des_port, to_server),
+					to_server,
+					tcp.get_flags(),
+					tcp.get_seq_num(),
+					payload,
+					h.payload_length[i],
+					caplen,
+					batch->ts_usec[i]
+				);
+			}
+			else if (app_type == noname_core::network::PacketType::HTTP) {
+				const bool to_server = des_port == noname_core::network::tcp_header::TCP_PORT_HTTP
+					|| des_port == noname_core::network::tcp_header::TCP_PORT_HTTP_ALT;
+
+				http.process(
+					make_flow(h.src_addr[i], h.des_addr[i], src_port, des_port, to_server),
+					to_server,
+					noname_core::network::tcp_view(data + h.l4_offset[i]).get_flags(),
+					payload,
+					h.payload_length[i],
+					batch->ts_usec[i]
+				);
+			}
+		}
+
+		timer.count(batch->size(), wire_bytes);
+	}
 
-		if (ether.get_next_packet_type() != noname_core::network::PacketType::IP)
-			continue;
+	{
+		noname_core::perf::trace_scope trace("merge stats");
+		noname_core::perf::hw_counter_scope scope(&merge_counters);
+		merge_stats(ret_mac, mac_stat);
+		merge_stats(ret_ip, ip_stat);
+		merge_stats(ret_port, port_stat);
+	}
 
-		noname_core::network::ip_header ip(packet.data + sizeof ether);
-		setup_map(ip_stat, ip.get_src_ip().to_string(), ip.get_des_ip().to_string(), packet.header->caplen);
+	// flows still waiting for a ClientHello are only counted here
+	tls.finish();
 
-		if (ip.get_next_packet_type() != noname_core::network::PacketType::TCP)
-			continue;
+	timer.stop();
 
-		noname_core::network::tcp_header port(packet.data + sizeof ether + sizeof ip);
-		setup_map(
-			port_stat, 
-			std::to_string(noname_core::network::bswap16(port.get_src_port())), 
-			std::to_string(noname_core::network::bswap16(port.get_des_port())), 
-			packet.header->caplen
-		);
-
-		for (auto& i : mac_stat) { if (ret_mac.count(i.first) > 0) ret_mac[i.first] += i.second; else ret_mac.insert(i); }
-		for (auto& i : ip_stat) { if (ip_stat.count(i.first) > 0) ip_stat[i.first] += i.second; else ip_stat.insert(i); }
-		for (auto& i : port_stat) { if (port_stat.count(i.first) > 0) port_stat[i.first] += i.second; else port_stat.insert(i); }
+	if (perf) {
+		perf->parse = parse_counters.read();
+		perf->aggregate = aggregate_counters.read();
+		perf->merge = merge_counters.read();
 	}
 	return 0;
 }
@@ -112,51 +279,303 @@ void print_data(noname_core::concurrent::concurrent_unordered_map<std::pair<std:
 	std::cout << std::endl;
 }
 
-int main()
+void print_channel_stats(int index, const noname_core::channel::Channel_stats& stats)
+{
+	std::cerr << "channel " << index << ":\tpushes " << stats.pushes << "\tpops " << stats.pops
+		<< "\tproducer blocked " << stats.producer_blocks << "\tconsumer blocked " << stats.consumer_blocks
+		<< "\thigh water " << stats.high_water_mark << "/" << stats.capacity << "\toccupancy";
+	for (auto bin : stats.occupancy_histogram)
+		std::cerr << " " << bin;
+	std::cerr << std::endl;
+}
+
+void print_map_stats(const char* name, const noname_core::concurrent::concurrent_unordered_map<std::pair<std::string, std::string>, send_data>& map)
+{
+	const auto stats = map.get_stats(true);
+	std::size_t valid = 0, deleted = 0, heap = 0;
+	std::vector<std::size_t> probes;
+	for (auto& s : stats.submaps_stats) {
+		valid += s.num_valid_buckets;
+		deleted += s.num_deleted_buckets;
+		heap += s.heap_bytes;
+		probes.resize(s.probe_length_histogram.size());
+		for (std::size_t i = 0; i < probes.size(); ++i)
+			probes[i] += s.probe_length_histogram[i];
+	}
+	std::cerr << name << " map:	entries " << stats.num_entries << "	submaps " << stats.num_submaps
+		<< "	bytes " << stats.total_bytes << " (heap " << heap << ")"
+		<< "	tombstones " << (valid ? (double)deleted / valid : 0.0) << "	probe length";
+	for (auto bin : probes)
+		std::cerr << " " << bin;
+	std::cerr << std::endl;
+}
+
+// Packets of the same host pair always go to the same worker so per-flow analyzer state stays local.
+int dispatch_index(const uint8_t* data, uint32_t caplen, int num_workers)
 {
+	noname_core::network::ethernet_view ether(data);
+	if (caplen < ether.LEN + noname_core::network::ip_view::MIN_LEN)
+		return 0;
+
+	if (ether.get_next_packet_type() != noname_core::network::PacketType::IP)
+		return 0;
+
+	// addresses sit at fixed offsets, so IP options do not matter here
+	noname_core::network::ip_view ip(ether.get_payload());
+	uint32_t h = ip.get_src_addr() ^ ip.get_des_addr();
+	h ^= h >> 16;
+	h *= 0x45D9F3B;
+	h ^= h >> 16;
+	return h % num_workers;
+}
+
+struct options {
+	std::string file = "test.pcap";
+	std::string filter;
+	bool verify_filter = false;
+	bool perf_report = false;
+	bool perf_counters = false;
+	std::string trace_file;
+};
+
+// usage: pcap_stats [-r file] [--verify-filter] [--perf-report] [--perf-counters] [--trace file.json] [filter expression]
+bool parse_options(int argc, char* argv[], options& opt)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+
+		if (arg == "-r" && i + 1 < argc) {
+			opt.file = argv[++i];
+		}
+		else if (arg == "--verify-filter") {
+			opt.verify_filter = true;
+		}
+		else if (arg == "--perf-report") {
+			opt.perf_report = true;
+		}
+		else if (arg == "--perf-counters") {
+			opt.perf_report = opt.perf_counters = true;
+		}
+		else if (arg == "--trace" && i + 1 < argc) {
+			opt.trace_file = argv[++i];
+		}
+		else if (!arg.empty() && arg[0] == '-') {
+			std::cerr << "unknown option: " << arg << std::endl;
+			return false;
+		}
+		else {
+			if (!opt.filter.empty()) opt.filter += ' ';
+			opt.filter += arg;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	options opt;
+	if (!parse_options(argc, argv, opt)) {
+		std::cerr << "usage: " << argv[0] << " [-r file] [--verify-filter] [--perf-report] [--perf-counters] [--trace file.json] [filter expression]" << std::endl;
+		return -1;
+	}
+
 	pcap_t* handle;
 	char errbuf[PCAP_ERRBUF_SIZE];
 
 	int res;
 	int count = 0;
 	int total_bytes = 0;
-	int i = 0;
 
 	struct pcap_pkthdr* header;
 	const u_char* packet;
 
-	noname_core::channel::channel<Packet, 10> chan[4];
+	noname_core::channel::channel<Batch, 10> chan[4];
+	Batch pending[4];
 	noname_core::concurrent::concurrent_unordered_map<std::pair<std::string, std::string>, send_data> ret_mac, ret_ip, ret_port;
+	noname_core::network::http_analyzer http[4];
+	noname_core::network::dns_analyzer dns[4];
+	noname_core::network::tls_analyzer tls[4];
+
+	handle = pcap_open_offline(opt.file.c_str(), errbuf);
+	if (handle == nullptr) {
+		std::cerr << errbuf << std::endl;
+		return -1;
+	}
+
+	struct bpf_program filter;
+	const bool use_filter = !opt.filter.empty();
+
+	if (use_filter && pcap_compile(handle, &filter, opt.filter.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1) {
+		std::cerr << "invalid filter: " << pcap_geterr(handle) << std::endl;
+		pcap_close(handle);
+		return -1;
+	}
+
+	noname_core::filter::bpf_evaluator evaluator;
+	if (use_filter) {
+		try {
+			evaluator = noname_core::filter::bpf_evaluator(filter);
+		}
+		catch (const std::invalid_argument& e) {
+			std::cerr << e.what() << ", falling back to pcap_offline_filter" << std::endl;
+		}
+	}
+
+	std::size_t filter_mismatches = 0;
 
-	handle = pcap_open_offline("test.pcap", errbuf);
-	if (handle == nullptr) return -1;
+	noname_core::perf::stage_stats reader_perf, merge_perf;
+	worker_perf workers_perf[4];
+	reader_perf.name = "reader";
+	merge_perf.name = "merge/print";
+
+	noname_core::perf::hw_counter_group reader_counters;
+	if (opt.perf_counters && !reader_counters.open()) {
+		std::cerr << "hardware counters disabled: " << reader_counters.get_error() << std::endl;
+		opt.perf_counters = false;
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		workers_perf[i].stage.name = "worker " + std::to_string(i);
+		workers_perf[i].use_counters = opt.perf_counters;
+	}
+
+	noname_core::perf::stage_timer reader_timer(opt.perf_report ? &reader_perf : nullptr);
+	const uint64_t run_start_nsec = noname_core::perf::now_nsec();
+	const double run_start_cpu = noname_core::perf::process_cpu_seconds();
+
+	noname_core::perf::tracer& tracer = noname_core::perf::tracer::instance();
+	if (!opt.trace_file.empty()) {
+		tracer.enable();
+		tracer.set_thread_name("reader");
+	}
+	uint64_t batch_begin_nsec[4] = { 0 };
 
 	std::vector<std::future<int>> threadpool;
 	threadpool.reserve(4);
 
 	for (int i = 0; i < 4; ++i)
-		threadpool[i] = std::async(std::launch::async, get_stats, std::ref(ret_mac), std::ref(ret_ip), std::ref(ret_port), std::ref(chan[i]));
+		threadpool.emplace_back(std::async(std::launch::async, get_stats, std::ref(ret_mac), std::ref(ret_ip), std::ref(ret_port), std::ref(http[i]), std::ref(dns[i]), std::ref(tls[i]), std::ref(chan[i]),
+			opt.perf_report ? &workers_perf[i] : nullptr));
 	
+	reader_timer.start();
+	reader_counters.start();
 	do {
 		res = pcap_next_ex(handle, &header, &packet);
 		if (res == 0) continue;
 		if (res == -1 || res == -2) break;
 
-		chan[i] << Packet{ header, packet };
-
-		i = (i + 1) % 4;
+		reader_timer.count(1, header->len);
+
+		// rejected packets never cost a channel hop or a parse
+		if (use_filter) {
+			bool accepted;
+			if (evaluator.empty()) {
+				accepted = pcap_offline_filter(&filter, header, packet) != 0;
+			}
+			else {
+				accepted = evaluator.match(header, packet);
+				if (opt.verify_filter && accepted != (pcap_offline_filter(&filter, header, packet) != 0))
+					filter_mismatches++;
+			}
+			if (!accepted) continue;
+		}
+
+		// the capture buffer is reused by the next pcap_next_ex, so the batch keeps its own copy
+		const int worker = dispatch_index(packet, header->caplen, 4);
+		if (!pending[worker]) {
+			pending[worker] = std::make_shared<noname_core::network::packet_batch>();
+			if (tracer.is_enabled()) batch_begin_nsec[worker] = tracer.clock_nsec();
+		}
+
+		pending[worker]->push(header->ts.tv_sec * 1000000ull + header->ts.tv_usec, header->caplen, header->len, packet);
+		if (pending[worker]->full()) {
+			tracer.complete("read batch", batch_begin_nsec[worker], tracer.clock_nsec());
+			reader_timer.blocked([&]() { chan[worker] << pending[worker]; });
+			pending[worker] = nullptr;
+		}
 
 	} while (1);
 
-	for (int i = 0; i < 4; ++i)
+	for (int i = 0; i < 4; ++i) {
+		if (pending[i]) {
+			tracer.complete("read batch", batch_begin_nsec[i], tracer.clock_nsec());
+			reader_timer.blocked([&]() { chan[i] << pending[i]; });
+		}
 		chan[i].close();
+	}
+	reader_counters.stop();
+	reader_timer.stop();
+
+	if (use_filter)
+		pcap_freecode(&filter);
+
+	if (opt.verify_filter)
+		std::cerr << "filter mismatches against pcap_offline_filter: " << filter_mismatches << std::endl;
 
 	for (int i = 0; i < 4; ++i)
 		auto ret = threadpool[i].get();
 
+	noname_core::perf::stage_timer merge_timer(opt.perf_report ? &merge_perf : nullptr);
+	merge_timer.start();
+	const uint64_t merge_begin_nsec = tracer.is_enabled() ? tracer.clock_nsec() : 0;
+
 	print_data(ret_mac);
 	print_data(ret_ip);
 	print_data(ret_port);
 
+	for (int i = 1; i < 4; ++i) {
+		http[0].merge(http[i]);
+		dns[0].merge(dns[i]);
+		tls[0].merge(tls[i]);
+	}
+	std::cout << http[0] << std::endl;
+	std::cout << dns[0] << std::endl;
+	std::cout << tls[0] << std::endl;
+
+	merge_timer.stop();
+	tracer.complete("merge/print", merge_begin_nsec, tracer.clock_nsec());
+
+	if (!opt.trace_file.empty() && !tracer.write(opt.trace_file))
+		std::cerr << "cannot write trace to " << opt.trace_file << std::endl;
+
+	if (opt.perf_report) {
+		noname_core::perf::perf_report report;
+		report.set_totals(
+			(noname_core::perf::now_nsec() - run_start_nsec) / 1e9,
+			noname_core::perf::process_cpu_seconds() - run_start_cpu,
+			reader_perf.packets,
+			reader_perf.bytes
+		);
+		report.add_stage(reader_perf);
+		for (int i = 0; i < 4; ++i)
+			report.add_stage(workers_perf[i].stage);
+		report.add_stage(merge_perf);
+
+		noname_core::perf::hw_counter_values parse, aggregate, merge;
+		uint64_t worker_packets = 0;
+		for (int i = 0; i < 4; ++i) {
+			parse += workers_perf[i].parse;
+			aggregate += workers_perf[i].aggregate;
+			merge += workers_perf[i].merge;
+			worker_packets += workers_perf[i].stage.packets;
+		}
+		report.add_counters("reader", reader_counters.read(), reader_perf.packets);
+		report.add_counters("parse", parse, worker_packets);
+		report.add_counters("aggregate", aggregate, worker_packets);
+		report.add_counters("merge", merge, worker_packets);
+		std::cerr << report << std::endl;
+
+		// only populated when built with NONAME_CHANNEL_STATS
+		for (int i = 0; i < 4; ++i) {
+			const noname_core::channel::Channel_stats stats = chan[i].get_stats();
+			if (stats.enabled)
+				print_channel_stats(i, stats);
+		}
+
+		print_map_stats("mac", ret_mac);
+		print_map_stats("ip", ret_ip);
+		print_map_stats("port", ret_port);
+	}
+
 	return 0;
 }
\ No newline at end of file